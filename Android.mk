@@ -11,7 +11,10 @@ zlib_files := \
 	src/crc32.c \
 	src/deflate.c \
 	src/gzclose.c \
+	src/gzindex.c \
 	src/gzlib.c \
+	src/gzpread.c \
+	src/gzpwrite.c \
 	src/gzread.c \
 	src/gzwrite.c \
 	src/infback.c \
@@ -20,6 +23,7 @@ zlib_files := \
 	src/inffast.c \
 	src/trees.c \
 	src/uncompr.c \
+	src/zpool.c \
 	src/zutil.c
 
 LOCAL_MODULE := libz
@@ -61,8 +61,25 @@ local uLong adler32_combine_ OF((uLong adler1, uLong adler2, z_off64_t len2));
 #  define MOD63(a) a %= BASE
 #endif
 
+/* Vector implementations, selected once at library load */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(NO_ADLER32_SIMD)
+#  define ADLER32_X86
+#endif
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+    !defined(NO_ADLER32_SIMD)
+#  define ADLER32_NEON
+#endif
+#if defined(ADLER32_X86) || defined(ADLER32_NEON)
+#  define ADLER32_DISPATCH
+#endif
+
 /* ========================================================================= */
+#ifdef ADLER32_DISPATCH
+local uLong adler32_generic(adler, buf, len)
+#else
 uLong ZEXPORT adler32(adler, buf, len)
+#endif
     uLong adler;
     const Bytef *buf;
     uInt len;
@@ -132,6 +149,259 @@ uLong ZEXPORT adler32(adler, buf, len)
     return adler | (sum2 << 16);
 }
 
+#ifdef ADLER32_DISPATCH
+/*
+  The vector versions compute the sums on blocks of BLK bytes.  Over n blocks
+  starting with sums s1 and s2, the new s2 is s2 + n * BLK * s1 plus, for
+  each block, BLK times the sum of all of the bytes in the preceding blocks
+  of this run plus the bytes of the block weighted BLK, BLK-1, ..., 1.  The
+  byte sums are accumulated in vector lanes, and the lanes are added up and
+  reduced once per run of at most NMAX bytes.  Leftover bytes are handed to
+  adler32_generic().
+ */
+#define BLK 32
+#endif
+
+#ifdef ADLER32_X86
+#include <cpuid.h>
+#include <immintrin.h>
+
+/* ========================================================================= */
+__attribute__((target("ssse3")))
+local uLong adler32_ssse3(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1, s2;
+    unsigned n, blks;
+    __m128i v_ps, v_s1, v_s2, bytes1, bytes2;
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    if (buf == Z_NULL || len < 2 * BLK)
+        return adler32_generic(adler, buf, len);
+
+    s1 = adler & 0xffff;
+    s2 = (adler >> 16) & 0xffff;
+    blks = len / BLK;
+    len -= blks * BLK;
+    while (blks) {
+        n = NMAX / BLK;
+        if (n > blks)
+            n = blks;
+        blks -= n;
+
+        v_ps = _mm_cvtsi32_si128((int)(s1 * n));
+        v_s2 = _mm_cvtsi32_si128((int)s2);
+        v_s1 = zero;
+        do {
+            bytes1 = _mm_loadu_si128((const __m128i *)buf);
+            bytes2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                        _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                        _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+            buf += BLK;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        /* add up the lanes */
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0xb1));
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0x4e));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0xb1));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0x4e));
+        s1 += (unsigned)_mm_cvtsi128_si32(v_s1);
+        s2 = (unsigned)_mm_cvtsi128_si32(v_s2);
+        MOD(s1);
+        MOD(s2);
+    }
+    return adler32_generic(s1 | (s2 << 16), buf, len);
+}
+
+/* ========================================================================= */
+__attribute__((target("avx2")))
+local uLong adler32_avx2(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1, s2;
+    unsigned n, blks;
+    __m256i v_ps, v_s1, v_s2, bytes;
+    __m128i sum1, sum2;
+    const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                         24, 23, 22, 21, 20, 19, 18, 17,
+                                         16, 15, 14, 13, 12, 11, 10, 9,
+                                         8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    if (buf == Z_NULL || len < 2 * BLK)
+        return adler32_generic(adler, buf, len);
+
+    s1 = adler & 0xffff;
+    s2 = (adler >> 16) & 0xffff;
+    blks = len / BLK;
+    len -= blks * BLK;
+    while (blks) {
+        n = NMAX / BLK;
+        if (n > blks)
+            n = blks;
+        blks -= n;
+
+        v_ps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        v_s2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+        v_s1 = zero;
+        do {
+            bytes = _mm256_loadu_si256((const __m256i *)buf);
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes, zero));
+            v_s2 = _mm256_add_epi32(v_s2,
+                    _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, tap), ones));
+            buf += BLK;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+
+        /* add up the lanes */
+        sum1 = _mm_add_epi32(_mm256_castsi256_si128(v_s1),
+                             _mm256_extracti128_si256(v_s1, 1));
+        sum2 = _mm_add_epi32(_mm256_castsi256_si128(v_s2),
+                             _mm256_extracti128_si256(v_s2, 1));
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, 0xb1));
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, 0x4e));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, 0xb1));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, 0x4e));
+        s1 += (unsigned)_mm_cvtsi128_si32(sum1);
+        s2 = (unsigned)_mm_cvtsi128_si32(sum2);
+        MOD(s1);
+        MOD(s2);
+    }
+    return adler32_generic(s1 | (s2 << 16), buf, len);
+}
+#endif /* ADLER32_X86 */
+
+#ifdef ADLER32_NEON
+#include <arm_neon.h>
+
+/* ========================================================================= */
+local uLong adler32_neon(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1, s2;
+    unsigned n, blks;
+    uint8x16_t bytes1, bytes2;
+    uint16x8_t col1, col2, col3, col4;
+    uint32x4_t v_s1, v_s2;
+    uint32x2_t sum1, sum2, s1s2;
+    static const uint16_t taps[BLK] = {
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+
+    if (buf == Z_NULL || len < 2 * BLK)
+        return adler32_generic(adler, buf, len);
+
+    s1 = adler & 0xffff;
+    s2 = (adler >> 16) & 0xffff;
+    blks = len / BLK;
+    len -= blks * BLK;
+    while (blks) {
+        n = NMAX / BLK;
+        if (n > blks)
+            n = blks;
+        blks -= n;
+
+        /* v_s2 gathers the sums of the preceding blocks, and the column sums
+           gather each byte position, to be weighted by the taps at the end
+           (at most NMAX / BLK * 255 each, so they fit in 16 bits) */
+        v_s2 = vsetq_lane_u32((uint32_t)(s1 * n), vdupq_n_u32(0), 0);
+        v_s1 = vdupq_n_u32(0);
+        col1 = col2 = col3 = col4 = vdupq_n_u16(0);
+        do {
+            bytes1 = vld1q_u8(buf);
+            bytes2 = vld1q_u8(buf + 16);
+            v_s2 = vaddq_u32(v_s2, v_s1);
+            v_s1 = vpadalq_u16(v_s1, vpadalq_u8(vpaddlq_u8(bytes1), bytes2));
+            col1 = vaddw_u8(col1, vget_low_u8(bytes1));
+            col2 = vaddw_u8(col2, vget_high_u8(bytes1));
+            col3 = vaddw_u8(col3, vget_low_u8(bytes2));
+            col4 = vaddw_u8(col4, vget_high_u8(bytes2));
+            buf += BLK;
+        } while (--n);
+        v_s2 = vshlq_n_u32(v_s2, 5);
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(col1), vld1_u16(taps));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(col1), vld1_u16(taps + 4));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(col2), vld1_u16(taps + 8));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(col2), vld1_u16(taps + 12));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(col3), vld1_u16(taps + 16));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(col3), vld1_u16(taps + 20));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(col4), vld1_u16(taps + 24));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(col4), vld1_u16(taps + 28));
+
+        /* add up the lanes */
+        sum1 = vpadd_u32(vget_low_u32(v_s1), vget_high_u32(v_s1));
+        sum2 = vpadd_u32(vget_low_u32(v_s2), vget_high_u32(v_s2));
+        s1s2 = vpadd_u32(sum1, sum2);
+        s1 += vget_lane_u32(s1s2, 0);
+        s2 += vget_lane_u32(s1s2, 1);
+        MOD(s1);
+        MOD(s2);
+    }
+    return adler32_generic(s1 | (s2 << 16), buf, len);
+}
+#endif /* ADLER32_NEON */
+
+#ifdef ADLER32_DISPATCH
+typedef uLong (*adler32_func_t) OF((uLong, const Bytef *, uInt));
+local adler32_func_t adler32_func = adler32_generic;
+
+/*
+ * On library load, pick the widest vector adler32() that the processor
+ * supports.  NEON is only compiled in when the compiler may already assume
+ * it, so it needs no run-time check.
+ */
+local void __attribute__ ((constructor)) init_adler32_func(void) {
+#ifdef ADLER32_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return;
+    if (ecx & bit_SSSE3)
+        adler32_func = adler32_ssse3;
+
+    /* AVX2 also needs the OS to save the ymm registers (OSXSAVE, XCR0) */
+    if ((ecx & bit_OSXSAVE) && __get_cpuid_max(0, Z_NULL) >= 7) {
+        unsigned int xcr0;
+
+        __asm__ ("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((xcr0 & 6) == 6 && (ebx & bit_AVX2))
+            adler32_func = adler32_avx2;
+    }
+#endif
+#ifdef ADLER32_NEON
+    adler32_func = adler32_neon;
+#endif
+}
+
+uLong ZEXPORT adler32(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    return adler32_func(adler, buf, len);
+}
+#endif /* ADLER32_DISPATCH */
+
 /* ========================================================================= */
 local uLong adler32_combine_(adler1, adler2, len2)
     uLong adler1;
@@ -27,6 +27,11 @@
  *      time, but has a larger average cost, uses more memory and is patented.
  *      However the F&G algorithm may be faster for some highly redundant
  *      files if the parameter max_chain_length (described below) is too large.
+ *         At level 9 with Z_MATCH_TREE, the strings with the same hash are
+ *      instead kept in a binary tree sorted on their contents, which is
+ *      searched and updated at every input character.  The insertions cost
+ *      more, but the longest match is found without walking a long chain of
+ *      failed candidates.
  *
  *  ACKNOWLEDGEMENTS
  *
@@ -78,10 +83,28 @@ local block_state deflate_stored OF((deflate_state *s, int flush));
 local block_state deflate_fast   OF((deflate_state *s, int flush));
 #ifndef FASTEST
 local block_state deflate_slow   OF((deflate_state *s, int flush));
+local block_state deflate_optimal OF((deflate_state *s, int flush));
+local uInt opt_matches    OF((deflate_state *s, IPos cur_match, ushf *len,
+                              ushf *dist));
+local void opt_parse      OF((deflate_state *s, uInt n, uch *lcost,
+                              uch *dcost));
+local void opt_tally      OF((deflate_state *s, uInt n, ushf *len,
+                              ushf *dist));
+local void opt_greedy     OF((deflate_state *s, uInt n, uInt far));
+local uInt tree_match     OF((deflate_state *s, IPos str, IPos cur_match,
+                              uInt end, IPos *start));
 #endif
 local block_state deflate_rle    OF((deflate_state *s, int flush));
 local block_state deflate_huff   OF((deflate_state *s, int flush));
+local block_state deflate_quick  OF((deflate_state *s, int flush));
 local void lm_init        OF((deflate_state *s));
+local int deflate_alloc   OF((z_streamp strm, ulg len));
+local void deflate_free   OF((z_streamp strm));
+#ifndef FASTEST
+local int opt_alloc       OF((z_streamp strm));
+local int tree_alloc      OF((z_streamp strm));
+#endif
+local void opt_carve      OF((opt_state *opt));
 local void putShortMSB    OF((deflate_state *s, uInt b));
 local void flush_pending  OF((z_streamp strm));
 local int read_buf        OF((z_streamp strm, Bytef *buf, unsigned size));
@@ -119,35 +142,42 @@ typedef struct config_s {
    ush max_lazy;    /* do not perform lazy search above this match length */
    ush nice_length; /* quit search above this match length */
    ush max_chain;
+   ush tree;        /* search binary trees instead of hash chains */
    compress_func func;
 } config;
 
 #ifdef FASTEST
 local const config configuration_table[2] = {
-/*      good lazy nice chain */
-/* 0 */ {0,    0,  0,    0, deflate_stored},  /* store only */
-/* 1 */ {4,    4,  8,    4, deflate_fast}}; /* max speed, no lazy matches */
+/*      good lazy nice chain tree */
+/* 0 */ {0,    0,  0,    0, 0, deflate_stored},  /* store only */
+/* 1 */ {4,    4,  8,    4, 0, deflate_fast}}; /* max speed, no lazy matches */
 #else
 local const config configuration_table[10] = {
-/*      good lazy nice chain */
-/* 0 */ {0,    0,  0,    0, deflate_stored},  /* store only */
-/* 1 */ {4,    4,  8,    4, deflate_fast}, /* max speed, no lazy matches */
-/* 2 */ {4,    5, 16,    8, deflate_fast},
-/* 3 */ {4,    6, 32,   32, deflate_fast},
-
-/* 4 */ {4,    4, 16,   16, deflate_slow},  /* lazy matches */
-/* 5 */ {8,   16, 32,   32, deflate_slow},
-/* 6 */ {8,   16, 128, 128, deflate_slow},
-/* 7 */ {8,   32, 128, 256, deflate_slow},
-/* 8 */ {32, 128, 258, 1024, deflate_slow},
-/* 9 */ {32, 258, 258, 4096, deflate_slow}}; /* max compression */
+/*      good lazy nice chain tree */
+/* 0 */ {0,    0,  0,    0, 0, deflate_stored},  /* store only */
+/* 1 */ {4,    4,  8,    4, 0, deflate_fast}, /* max speed, no lazy matches */
+/* 2 */ {4,    5, 16,    8, 0, deflate_fast},
+/* 3 */ {4,    6, 32,   32, 0, deflate_fast},
+
+/* 4 */ {4,    4, 16,   16, 0, deflate_slow},  /* lazy matches */
+/* 5 */ {8,   16, 32,   32, 0, deflate_slow},
+/* 6 */ {8,   16, 128, 128, 0, deflate_slow},
+/* 7 */ {8,   32, 128, 256, 0, deflate_slow},
+/* 8 */ {32, 128, 258, 1024, 0, deflate_slow},
+/* 9 */ {32, 258, 258, 4096, 1, deflate_slow}}; /* max compression */
 #endif
 
 /* Note: the deflate() code requires max_lazy >= MIN_MATCH and max_chain >= 4
  * For deflate_fast() (levels <= 3) good is ignored and lazy has a different
- * meaning.
+ * meaning.  With tree, chain limits the depth of the search instead.
  */
 
+/* True if deflate_slow() is used with binary trees for level and strategy */
+#define USE_TREE(s, level, strategy) ((s)->tree_ok && \
+    configuration_table[level].tree && \
+    ((strategy) == Z_DEFAULT_STRATEGY || (strategy) == Z_FILTERED || \
+     (strategy) == Z_FIXED))
+
 #define EQUAL 0
 /* result of memcmp for equal strings */
 
@@ -166,6 +196,68 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 #define UPDATE_HASH(s,h,c) (h = (((h)<<s->hash_shift) ^ (c)) & s->hash_mask)
 
+/* ===========================================================================
+ * Set ins_h to the hash of the string at window index str.  If hash_crc is
+ * set (Z_HASH_CRC was given and the processor has the instruction), this is
+ * the CRC-32C of the four bytes at str, computed with a single instruction.
+ * Otherwise the running hash is updated with the MIN_MATCH'th byte of str,
+ * as with UPDATE_HASH.  The CRC mode distributes strings much more evenly
+ * over the hash table, which shortens the chains to be searched, at the cost
+ * of no longer finding matches of length three.
+ * IN  assertion: the bytes up to str + 3 can be read (see WIN_PAD).
+ */
+#if !defined(ASMV) && !defined(NO_HASH_CRC) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+#  define HASH_CRC
+#endif
+
+#ifdef HASH_CRC
+#ifdef __aarch64__
+#  include <sys/auxv.h>
+#  ifndef HWCAP_CRC32
+#    define HWCAP_CRC32 (1 << 7)
+#  endif
+#else
+#  include <cpuid.h>
+#endif
+
+local int hash_crc_supported = 0;
+
+/* On library load, see if the processor has CRC-32C instructions */
+local void __attribute__ ((constructor)) init_hash_crc(void) {
+#ifdef __aarch64__
+    hash_crc_supported = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+
+    hash_crc_supported = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                         (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+local uInt hash_crc OF((const Bytef *str));
+local uInt hash_crc(str)
+    const Bytef *str;
+{
+    unsigned val, h = 0;
+
+    zmemcpy((Bytef *)&val, str, sizeof(val));
+#ifdef __aarch64__
+    __asm__("crc32cw %w0, %w0, %w1" : "+r"(h) : "r"(val));
+#else
+    __asm__("crc32l %1, %0" : "+r"(h) : "rm"(val));
+#endif
+    return h;
+}
+
+#  define UPDATE_HASH_STR(s, str) \
+    (s->hash_crc ? (s->ins_h = hash_crc(s->window + (str)) & s->hash_mask) : \
+     UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]))
+#else
+#  define UPDATE_HASH_STR(s, str) \
+    UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)])
+#endif
+
 
 /* ===========================================================================
  * Insert string str in the dictionary and set match_head to the previous head
@@ -179,12 +271,12 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 #ifdef FASTEST
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (UPDATE_HASH_STR(s, str), \
     match_head = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #else
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (UPDATE_HASH_STR(s, str), \
     match_head = s->prev[(str) & s->w_mask] = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #endif
@@ -225,11 +317,6 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
     int wrap = 1;
     static const char my_version[] = ZLIB_VERSION;
 
-    ushf *overlay;
-    /* We overlay pending_buf and d_buf+l_buf. This works since the average
-     * output size for (length,distance) codes is <= 24 bits.
-     */
-
     if (version == Z_NULL || version[0] != my_version[0] ||
         stream_size != sizeof(z_stream)) {
         return Z_VERSION_ERROR;
@@ -270,7 +357,8 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
 #endif
     if (memLevel < 1 || memLevel > MAX_MEM_LEVEL || method != Z_DEFLATED ||
         windowBits < 8 || windowBits > 15 || level < 0 || level > 9 ||
-        strategy < 0 || strategy > Z_FIXED) {
+        strategy < 0 ||
+        (strategy & ~(Z_HASH_CRC | Z_MATCH_TREE)) > Z_OPTIMAL) {
         return Z_STREAM_ERROR;
     }
     if (windowBits == 8) windowBits = 9;  /* until 256-byte window bug fixed */
@@ -290,35 +378,98 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
     s->hash_mask = s->hash_size - 1;
     s->hash_shift =  ((s->hash_bits+MIN_MATCH-1)/MIN_MATCH);
 
-    s->window = (Bytef *) ZALLOC(strm, s->w_size, 2*sizeof(Byte));
-    s->prev   = (Posf *)  ZALLOC(strm, s->w_size, sizeof(Pos));
-    s->head   = (Posf *)  ZALLOC(strm, s->hash_size, sizeof(Pos));
-
-    s->high_water = 0;      /* nothing written to s->window yet */
-
     s->lit_bufsize = 1 << (memLevel + 6); /* 16K elements by default */
 
-    overlay = (ushf *) ZALLOC(strm, s->lit_bufsize, sizeof(ush)+2);
-    s->pending_buf = (uchf *) overlay;
-    s->pending_buf_size = (ulg)s->lit_bufsize * (sizeof(ush)+2L);
-
-    if (s->window == Z_NULL || s->prev == Z_NULL || s->head == Z_NULL ||
-        s->pending_buf == Z_NULL) {
-        s->status = FINISH_STATE;
-        strm->msg = ERR_MSG(Z_MEM_ERROR);
-        deflateEnd (strm);
-        return Z_MEM_ERROR;
-    }
-    s->d_buf = overlay + s->lit_bufsize/sizeof(ush);
-    s->l_buf = s->pending_buf + (1+sizeof(ush))*s->lit_bufsize;
-
+    /* the window, hash table, and pending buffer are allocated by the first
+       deflate() call -- see deflate_alloc() */
+    s->window = Z_NULL;
+    s->prev = Z_NULL;
+    s->right = Z_NULL;      /* allocated by deflate() for the binary trees */
+    s->head = Z_NULL;
+    s->pending_buf = Z_NULL;
+    s->opt = Z_NULL;        /* allocated by deflate() for Z_OPTIMAL */
+
+#ifdef HASH_CRC
+    s->hash_crc = (strategy & Z_HASH_CRC) && hash_crc_supported;
+#else
+    s->hash_crc = 0;
+#endif
+    s->tree_ok = (strategy & Z_MATCH_TREE) != 0;
     s->level = level;
-    s->strategy = strategy;
+    s->strategy = strategy & ~(Z_HASH_CRC | Z_MATCH_TREE);
     s->method = (Byte)method;
 
     return deflateReset(strm);
 }
 
+/* ========================================================================= */
+uLong ZEXPORT deflateStateSize(windowBits, memLevel)
+    int windowBits;
+    int memLevel;
+{
+    ulg w_size, hash_size, lit_bufsize;
+
+    /* same parameter checks and sizes as deflateInit2_() */
+    if (windowBits < 0)
+        windowBits = -windowBits;
+#ifdef GZIP
+    else if (windowBits > 15)
+        windowBits -= 16;
+#endif
+    if (memLevel < 1 || memLevel > MAX_MEM_LEVEL ||
+        windowBits < 8 || windowBits > 15)
+        return 0;
+    if (windowBits == 8) windowBits = 9;
+    w_size = 1UL << windowBits;
+    hash_size = 1UL << (memLevel + 7);
+    lit_bufsize = 1UL << (memLevel + 6);
+    return Z_ARENA_HEAD + Z_ARENA_SIZE(sizeof(deflate_state)) +
+           Z_ARENA_SIZE((w_size + WIN_PAD) * 2*sizeof(Byte)) +
+           Z_ARENA_SIZE(w_size * sizeof(Pos)) * 2 +
+           Z_ARENA_SIZE(hash_size * sizeof(Pos)) +
+           Z_ARENA_SIZE(lit_bufsize * (sizeof(ush)+2));
+}
+
+/* ========================================================================= */
+int ZEXPORT deflateInitArena_(strm, level, method, windowBits, memLevel,
+                              strategy, mem, size, version, stream_size)
+    z_streamp strm;
+    int  level;
+    int  method;
+    int  windowBits;
+    int  memLevel;
+    int  strategy;
+    voidpf mem;
+    uLong size;
+    const char *version;
+    int stream_size;
+{
+    uLong need;
+    int ret;
+
+    if (strm == Z_NULL || mem == Z_NULL) return Z_STREAM_ERROR;
+    if ((strategy & ~(Z_HASH_CRC | Z_MATCH_TREE)) == Z_OPTIMAL)
+        return Z_STREAM_ERROR;  /* its work space is not in the arena */
+    need = deflateStateSize(windowBits, memLevel);
+    if (need == 0) return Z_STREAM_ERROR;
+    if (size < need) return Z_MEM_ERROR;
+    strm->zalloc = zaralloc;
+    strm->zfree = zarfree;
+    strm->opaque = zarena(mem, size);
+    ret = deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
+                        version, stream_size);
+    if (ret != Z_OK)
+        return ret;
+
+    /* allocate all of the memory now at full size, since memory freed to the
+       arena is not reused */
+    if (deflate_alloc(strm, ~(ulg)0) != Z_OK) {
+        deflateEnd(strm);
+        return Z_MEM_ERROR;
+    }
+    return Z_OK;
+}
+
 /* ========================================================================= */
 int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
     z_streamp strm;
@@ -337,6 +488,12 @@ int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
     wrap = s->wrap;
     if (wrap == 2 || (wrap == 1 && s->status != INIT_STATE) || s->lookahead)
         return Z_STREAM_ERROR;
+    if (deflate_alloc(strm, ~(ulg)0) != Z_OK)
+        return Z_MEM_ERROR;
+#ifndef FASTEST
+    if (tree_alloc(strm) != Z_OK)
+        return Z_MEM_ERROR;
+#endif
 
     /* when using zlib wrappers, compute Adler-32 for provided dictionary */
     if (wrap == 1)
@@ -365,9 +522,12 @@ int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
         str = s->strstart;
         n = s->lookahead - (MIN_MATCH-1);
         do {
-            UPDATE_HASH(s, s->ins_h, s->window[str + MIN_MATCH-1]);
+            UPDATE_HASH_STR(s, str);
 #ifndef FASTEST
             s->prev[str & s->w_mask] = s->head[s->ins_h];
+            if (s->match_tree)
+                tree_match(s, str, s->prev[str & s->w_mask],
+                           s->strstart + s->lookahead, Z_NULL);
 #endif
             s->head[s->ins_h] = (Pos)str;
             str++;
@@ -453,10 +613,11 @@ int ZEXPORT deflatePending (strm, pending, bits)
     z_streamp strm;
 {
     if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
+    /* whole bytes still in the bit buffer count as pending */
     if (pending != Z_NULL)
-        *pending = strm->state->pending;
+        *pending = strm->state->pending + (strm->state->bi_valid >> 3);
     if (bits != Z_NULL)
-        *bits = strm->state->bi_valid;
+        *bits = strm->state->bi_valid & 7;
     return Z_OK;
 }
 
@@ -469,15 +630,18 @@ int ZEXPORT deflatePrime (strm, bits, value)
     deflate_state *s;
     int put;
 
-    if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
+    if (strm == Z_NULL || strm->state == Z_NULL || bits < 0 || bits > 16)
+        return Z_STREAM_ERROR;
     s = strm->state;
+    if (deflate_alloc(strm, ~(ulg)0) != Z_OK)
+        return Z_MEM_ERROR;
     if ((Bytef *)(s->d_buf) < s->pending_out + ((Buf_size + 7) >> 3))
         return Z_BUF_ERROR;
     do {
         put = Buf_size - s->bi_valid;
         if (put > bits)
             put = bits;
-        s->bi_buf |= (ush)((value & ((1 << put) - 1)) << s->bi_valid);
+        s->bi_buf |= (bi_word)(value & ((1 << put) - 1)) << s->bi_valid;
         s->bi_valid += put;
         _tr_flush_bits(s);
         value >>= put;
@@ -494,6 +658,7 @@ int ZEXPORT deflateParams(strm, level, strategy)
 {
     deflate_state *s;
     compress_func func;
+    int tree;
     int err = Z_OK;
 
     if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
@@ -504,9 +669,11 @@ int ZEXPORT deflateParams(strm, level, strategy)
 #else
     if (level == Z_DEFAULT_COMPRESSION) level = 6;
 #endif
-    if (level < 0 || level > 9 || strategy < 0 || strategy > Z_FIXED) {
+    if (level < 0 || level > 9 || strategy < 0 || strategy > Z_OPTIMAL) {
         return Z_STREAM_ERROR;
     }
+    if (strategy == Z_OPTIMAL && strm->zalloc == zaralloc)
+        return Z_STREAM_ERROR;  /* no room in the arena for Z_OPTIMAL */
     func = configuration_table[s->level].func;
 
     if ((strategy != s->strategy || func != configuration_table[level].func) &&
@@ -523,6 +690,14 @@ int ZEXPORT deflateParams(strm, level, strategy)
         s->nice_match       = configuration_table[level].nice_length;
         s->max_chain_length = configuration_table[level].max_chain;
     }
+    tree = USE_TREE(s, level, strategy);
+    if (((s->strategy == Z_QUICK && strategy != Z_QUICK) ||
+         tree != s->match_tree) && s->head != Z_NULL) {
+        /* Z_QUICK does not link its hash table entries with prev[], and the
+           binary trees and the hash chains use prev[] differently */
+        CLEAR_HASH(s);
+    }
+    s->match_tree = tree;
     s->strategy = strategy;
     return err;
 }
@@ -661,6 +836,18 @@ local void flush_pending(strm)
     }
 }
 
+/* ===========================================================================
+ * Update the gzip header crc with the header bytes written to pending_buf
+ * since beg, if a header crc is wanted.  Used by deflate() while writing the
+ * extra field, name, and comment, which may not fit in pending_buf at once.
+ */
+#define HCRC_UPDATE(beg) \
+    do { \
+        if (s->gzhead->hcrc && s->pending > (beg)) \
+            strm->adler = crc32(strm->adler, s->pending_buf + (beg), \
+                                s->pending - (beg)); \
+    } while (0)
+
 /* ========================================================================= */
 int ZEXPORT deflate (strm, flush)
     z_streamp strm;
@@ -682,6 +869,19 @@ int ZEXPORT deflate (strm, flush)
     }
     if (strm->avail_out == 0) ERR_RETURN(strm, Z_BUF_ERROR);
 
+    /* on the first call, if all of the input is here, size the memory to it,
+       or else make it larger if what was kept from before a reset is small */
+    if ((s->window == Z_NULL || strm->total_in == 0) &&
+        deflate_alloc(strm, flush == Z_FINISH ? strm->avail_in : ~(ulg)0) !=
+            Z_OK)
+        ERR_RETURN(strm, Z_MEM_ERROR);
+#ifndef FASTEST
+    if (s->strategy == Z_OPTIMAL && s->level && opt_alloc(strm) != Z_OK)
+        ERR_RETURN(strm, Z_MEM_ERROR);
+    if (tree_alloc(strm) != Z_OK)
+        ERR_RETURN(strm, Z_MEM_ERROR);
+#endif
+
     s->strm = strm; /* just in case */
     old_flush = s->last_flush;
     s->last_flush = flush;
@@ -762,33 +962,45 @@ int ZEXPORT deflate (strm, flush)
         }
     }
 #ifdef GZIP
+    if ((s->status == EXTRA_STATE || s->status == NAME_STATE ||
+         s->status == COMMENT_STATE || s->status == HCRC_STATE) &&
+        s->pending_out != s->pending_buf) {
+        /* the rest of the header is written at pending_buf + pending, so
+           first send what is left from the last call */
+        flush_pending(strm);
+        if (s->pending != 0) {
+            s->last_flush = -1;
+            return Z_OK;
+        }
+    }
     if (s->status == EXTRA_STATE) {
         if (s->gzhead->extra != Z_NULL) {
             uInt beg = s->pending;  /* start of bytes to update crc */
+            uInt left = (s->gzhead->extra_len & 0xffff) - s->gzindex;
 
-            while (s->gzindex < (s->gzhead->extra_len & 0xffff)) {
-                if (s->pending == s->pending_buf_size) {
-                    if (s->gzhead->hcrc && s->pending > beg)
-                        strm->adler = crc32(strm->adler, s->pending_buf + beg,
-                                            s->pending - beg);
-                    flush_pending(strm);
-                    beg = s->pending;
-                    if (s->pending == s->pending_buf_size)
-                        break;
+            while (s->pending + left > s->pending_buf_size) {
+                uInt copy = (uInt)(s->pending_buf_size - s->pending);
+
+                zmemcpy(s->pending_buf + s->pending,
+                        s->gzhead->extra + s->gzindex, copy);
+                s->pending = (uInt)s->pending_buf_size;
+                HCRC_UPDATE(beg);
+                s->gzindex += copy;
+                flush_pending(strm);
+                if (s->pending != 0) {
+                    s->last_flush = -1;
+                    return Z_OK;
                 }
-                put_byte(s, s->gzhead->extra[s->gzindex]);
-                s->gzindex++;
-            }
-            if (s->gzhead->hcrc && s->pending > beg)
-                strm->adler = crc32(strm->adler, s->pending_buf + beg,
-                                    s->pending - beg);
-            if (s->gzindex == s->gzhead->extra_len) {
-                s->gzindex = 0;
-                s->status = NAME_STATE;
+                beg = 0;
+                left -= copy;
             }
+            zmemcpy(s->pending_buf + s->pending,
+                    s->gzhead->extra + s->gzindex, left);
+            s->pending += left;
+            HCRC_UPDATE(beg);
+            s->gzindex = 0;
         }
-        else
-            s->status = NAME_STATE;
+        s->status = NAME_STATE;
     }
     if (s->status == NAME_STATE) {
         if (s->gzhead->name != Z_NULL) {
@@ -797,29 +1009,21 @@ int ZEXPORT deflate (strm, flush)
 
             do {
                 if (s->pending == s->pending_buf_size) {
-                    if (s->gzhead->hcrc && s->pending > beg)
-                        strm->adler = crc32(strm->adler, s->pending_buf + beg,
-                                            s->pending - beg);
+                    HCRC_UPDATE(beg);
                     flush_pending(strm);
-                    beg = s->pending;
-                    if (s->pending == s->pending_buf_size) {
-                        val = 1;
-                        break;
+                    if (s->pending != 0) {
+                        s->last_flush = -1;
+                        return Z_OK;
                     }
+                    beg = 0;
                 }
                 val = s->gzhead->name[s->gzindex++];
                 put_byte(s, val);
             } while (val != 0);
-            if (s->gzhead->hcrc && s->pending > beg)
-                strm->adler = crc32(strm->adler, s->pending_buf + beg,
-                                    s->pending - beg);
-            if (val == 0) {
-                s->gzindex = 0;
-                s->status = COMMENT_STATE;
-            }
+            HCRC_UPDATE(beg);
+            s->gzindex = 0;
         }
-        else
-            s->status = COMMENT_STATE;
+        s->status = COMMENT_STATE;
     }
     if (s->status == COMMENT_STATE) {
         if (s->gzhead->comment != Z_NULL) {
@@ -828,41 +1032,35 @@ int ZEXPORT deflate (strm, flush)
 
             do {
                 if (s->pending == s->pending_buf_size) {
-                    if (s->gzhead->hcrc && s->pending > beg)
-                        strm->adler = crc32(strm->adler, s->pending_buf + beg,
-                                            s->pending - beg);
+                    HCRC_UPDATE(beg);
                     flush_pending(strm);
-                    beg = s->pending;
-                    if (s->pending == s->pending_buf_size) {
-                        val = 1;
-                        break;
+                    if (s->pending != 0) {
+                        s->last_flush = -1;
+                        return Z_OK;
                     }
+                    beg = 0;
                 }
                 val = s->gzhead->comment[s->gzindex++];
                 put_byte(s, val);
             } while (val != 0);
-            if (s->gzhead->hcrc && s->pending > beg)
-                strm->adler = crc32(strm->adler, s->pending_buf + beg,
-                                    s->pending - beg);
-            if (val == 0)
-                s->status = HCRC_STATE;
+            HCRC_UPDATE(beg);
         }
-        else
-            s->status = HCRC_STATE;
+        s->status = HCRC_STATE;
     }
     if (s->status == HCRC_STATE) {
         if (s->gzhead->hcrc) {
-            if (s->pending + 2 > s->pending_buf_size)
+            if (s->pending + 2 > s->pending_buf_size) {
                 flush_pending(strm);
-            if (s->pending + 2 <= s->pending_buf_size) {
-                put_byte(s, (Byte)(strm->adler & 0xff));
-                put_byte(s, (Byte)((strm->adler >> 8) & 0xff));
-                strm->adler = crc32(0L, Z_NULL, 0);
-                s->status = BUSY_STATE;
+                if (s->pending != 0) {
+                    s->last_flush = -1;
+                    return Z_OK;
+                }
             }
+            put_byte(s, (Byte)(strm->adler & 0xff));
+            put_byte(s, (Byte)((strm->adler >> 8) & 0xff));
+            strm->adler = crc32(0L, Z_NULL, 0);
         }
-        else
-            s->status = BUSY_STATE;
+        s->status = BUSY_STATE;
     }
 #endif
 
@@ -900,9 +1098,18 @@ int ZEXPORT deflate (strm, flush)
         (flush != Z_NO_FLUSH && s->status != FINISH_STATE)) {
         block_state bstate;
 
-        bstate = s->strategy == Z_HUFFMAN_ONLY ? deflate_huff(s, flush) :
-                    (s->strategy == Z_RLE ? deflate_rle(s, flush) :
-                        (*(configuration_table[s->level].func))(s, flush));
+        if (s->strategy == Z_HUFFMAN_ONLY)
+            bstate = deflate_huff(s, flush);
+        else if (s->strategy == Z_RLE)
+            bstate = deflate_rle(s, flush);
+        else if (s->strategy == Z_QUICK && s->level)
+            bstate = deflate_quick(s, flush);
+#ifndef FASTEST
+        else if (s->strategy == Z_OPTIMAL && s->level)
+            bstate = deflate_optimal(s, flush);
+#endif
+        else
+            bstate = (*(configuration_table[s->level].func))(s, flush);
 
         if (bstate == finish_started || bstate == finish_done) {
             s->status = FINISH_STATE;
@@ -995,8 +1202,10 @@ int ZEXPORT deflateEnd (strm)
     }
 
     /* Deallocate in reverse order of allocations: */
+    TRY_FREE(strm, strm->state->opt);
     TRY_FREE(strm, strm->state->pending_buf);
     TRY_FREE(strm, strm->state->head);
+    TRY_FREE(strm, strm->state->right);
     TRY_FREE(strm, strm->state->prev);
     TRY_FREE(strm, strm->state->window);
 
@@ -1026,6 +1235,8 @@ int ZEXPORT deflateCopy (dest, source)
     if (source == Z_NULL || dest == Z_NULL || source->state == Z_NULL) {
         return Z_STREAM_ERROR;
     }
+    if (source->zalloc == zaralloc)
+        return Z_STREAM_ERROR;  /* no room in the arena for a copy */
 
     ss = source->state;
 
@@ -1037,7 +1248,16 @@ int ZEXPORT deflateCopy (dest, source)
     zmemcpy((voidpf)ds, (voidpf)ss, sizeof(deflate_state));
     ds->strm = dest;
 
-    ds->window = (Bytef *) ZALLOC(dest, ds->w_size, 2*sizeof(Byte));
+    ds->window = Z_NULL;
+    ds->prev = Z_NULL;
+    ds->right = Z_NULL;
+    ds->head = Z_NULL;
+    ds->pending_buf = Z_NULL;
+    ds->opt = Z_NULL;
+    if (ss->window == Z_NULL)       /* nothing allocated yet */
+        return Z_OK;
+
+    ds->window = (Bytef *) ZALLOC(dest, ds->w_size + WIN_PAD, 2*sizeof(Byte));
     ds->prev   = (Posf *)  ZALLOC(dest, ds->w_size, sizeof(Pos));
     ds->head   = (Posf *)  ZALLOC(dest, ds->hash_size, sizeof(Pos));
     overlay = (ushf *) ZALLOC(dest, ds->lit_bufsize, sizeof(ush)+2);
@@ -1049,7 +1269,7 @@ int ZEXPORT deflateCopy (dest, source)
         return Z_MEM_ERROR;
     }
     /* following zmemcpy do not work for 16-bit MSDOS */
-    zmemcpy(ds->window, ss->window, ds->w_size * 2 * sizeof(Byte));
+    zmemcpy(ds->window, ss->window, (ds->w_size + WIN_PAD) * 2 * sizeof(Byte));
     zmemcpy((voidpf)ds->prev, (voidpf)ss->prev, ds->w_size * sizeof(Pos));
     zmemcpy((voidpf)ds->head, (voidpf)ss->head, ds->hash_size * sizeof(Pos));
     zmemcpy(ds->pending_buf, ss->pending_buf, (uInt)ds->pending_buf_size);
@@ -1062,6 +1282,29 @@ int ZEXPORT deflateCopy (dest, source)
     ds->d_desc.dyn_tree = ds->dyn_dtree;
     ds->bl_desc.dyn_tree = ds->bl_tree;
 
+    if (ss->right != Z_NULL) {
+        ds->right = (Posf *) ZALLOC(dest, ds->w_size, sizeof(Pos));
+        if (ds->right == Z_NULL) {
+            deflateEnd (dest);
+            return Z_MEM_ERROR;
+        }
+        zmemcpy((voidpf)ds->right, (voidpf)ss->right,
+                ds->w_size * sizeof(Pos));
+    }
+
+    /* copy the Z_OPTIMAL work space, which may hold a partial block */
+    if (ss->opt != Z_NULL) {
+        ds->opt = (opt_state *) ZALLOC(dest,
+                                       (uInt)OPT_BYTES(ss->opt->size), 1);
+        if (ds->opt == Z_NULL) {
+            deflateEnd (dest);
+            return Z_MEM_ERROR;
+        }
+        zmemcpy((voidpf)ds->opt, (voidpf)ss->opt,
+                (uInt)OPT_BYTES(ss->opt->size));
+        opt_carve(ds->opt);
+    }
+
     return Z_OK;
 #endif /* MAXSEG_64K */
 }
@@ -1100,6 +1343,164 @@ local int read_buf(strm, buf, size)
     return (int)len;
 }
 
+/* ===========================================================================
+ * Allocate the window, hash table, and pending buffer on the first use of the
+ * stream.  len is the total length of the input if it is known, or ~0.  A
+ * short input gets a smaller window and literal buffer, just large enough
+ * that the compressed data is the same as with the full sizes: a match can
+ * reach back to the start of the input, the window never slides, and no block
+ * is ended early by a full literal buffer or pending buffer.  The hash table
+ * is always full size, since its size decides which match candidates are
+ * found.  Buffers already allocated, as kept by deflateReset(), are used if
+ * they are large enough for len, or if they already hold data.  Otherwise they
+ * are freed and allocated again.  Return Z_OK, or Z_MEM_ERROR if out of
+ * memory.
+ */
+local int deflate_alloc(strm, len)
+    z_streamp strm;
+    ulg len;
+{
+    deflate_state *s = strm->state;
+    uInt wbits, lbits;
+    ushf *overlay;
+    /* We overlay pending_buf and d_buf+l_buf. This works since the average
+     * output size for (length,distance) codes is <= 24 bits.
+     */
+
+    /* note: keep deflateStateSize() in step with these allocations */
+    wbits = 9;
+    while (wbits < s->w_bits && len >= (1UL << wbits) - MIN_LOOKAHEAD)
+        wbits++;
+    lbits = 7;
+    while (lbits < s->hash_bits - 1 && len >= (1UL << lbits) - 1)
+        lbits++;
+    if (s->window != Z_NULL) {
+        if ((s->w_size >= 1U << wbits && s->lit_bufsize >= 1U << lbits) ||
+            strm->total_in || s->strstart || s->lookahead || s->pending)
+            return Z_OK;
+        deflate_free(strm);
+    }
+    s->w_size = 1 << wbits;
+    s->w_mask = s->w_size - 1;
+    s->window_size = (ulg)2L*s->w_size;
+    s->lit_bufsize = 1 << lbits;
+
+    s->window = (Bytef *) ZALLOC(strm, s->w_size + WIN_PAD, 2*sizeof(Byte));
+    s->prev   = (Posf *)  ZALLOC(strm, s->w_size, sizeof(Pos));
+    if (s->head == Z_NULL) {
+        s->head = (Posf *) ZALLOC(strm, s->hash_size, sizeof(Pos));
+        if (s->head != Z_NULL) {
+            CLEAR_HASH(s);
+        }
+    }
+    overlay = (ushf *) ZALLOC(strm, s->lit_bufsize, sizeof(ush)+2);
+    s->pending_buf = (uchf *) overlay;
+    s->pending_buf_size = (ulg)s->lit_bufsize * (sizeof(ush)+2L);
+
+    if (s->window == Z_NULL || s->prev == Z_NULL || s->head == Z_NULL ||
+        s->pending_buf == Z_NULL) {
+        deflate_free(strm);
+        return Z_MEM_ERROR;
+    }
+    s->pending_out = s->pending_buf;
+    s->d_buf = overlay + s->lit_bufsize/sizeof(ush);
+    s->l_buf = s->pending_buf + (1+sizeof(ush))*s->lit_bufsize;
+    zmemzero(s->window + 2*s->w_size, 2*WIN_PAD);
+    s->high_water = 0;      /* nothing written to s->window yet */
+    return Z_OK;
+}
+
+/* ===========================================================================
+ * Free the window and pending buffer and restore their full sizes, so that
+ * the next deflate() call allocates them again.  The hash table is kept.
+ */
+local void deflate_free(strm)
+    z_streamp strm;
+{
+    deflate_state *s = strm->state;
+
+    TRY_FREE(strm, s->pending_buf);
+    TRY_FREE(strm, s->right);
+    TRY_FREE(strm, s->prev);
+    TRY_FREE(strm, s->window);
+    s->pending_buf = Z_NULL;
+    s->pending_out = Z_NULL;
+    s->right = Z_NULL;
+    s->prev = Z_NULL;
+    s->window = Z_NULL;
+    s->w_size = 1 << s->w_bits;
+    s->w_mask = s->w_size - 1;
+    s->window_size = (ulg)2L*s->w_size;
+    s->lit_bufsize = 1 << (s->hash_bits - 1);
+}
+
+#ifndef FASTEST
+/* ===========================================================================
+ * Allocate the Z_OPTIMAL work space, if it is not already big enough for a
+ * segment with the current window and literal buffer sizes.  Return Z_OK, or
+ * Z_MEM_ERROR if out of memory.
+ */
+local int opt_alloc(strm)
+    z_streamp strm;
+{
+    deflate_state *s = strm->state;
+    uInt size;
+
+    size = s->lit_bufsize - 1;
+    if (size > MAX_DIST(s)) size = MAX_DIST(s);
+    if (s->opt != Z_NULL) {
+        if (s->opt->size >= size)
+            return Z_OK;
+        ZFREE(strm, s->opt);
+    }
+    s->opt = (opt_state *) ZALLOC(strm, (uInt)OPT_BYTES(size), 1);
+    if (s->opt == Z_NULL)
+        return Z_MEM_ERROR;
+    s->opt->size = size;
+    s->opt->count = 0;
+    opt_carve(s->opt);
+    return Z_OK;
+}
+
+/* ===========================================================================
+ * Allocate right[] for the binary tree match finder, if it is used and not
+ * allocated yet.  Return Z_OK, or Z_MEM_ERROR if out of memory.
+ */
+local int tree_alloc(strm)
+    z_streamp strm;
+{
+    deflate_state *s = strm->state;
+
+    if (s->match_tree && s->right == Z_NULL) {
+        s->right = (Posf *) ZALLOC(strm, s->w_size, sizeof(Pos));
+        if (s->right == Z_NULL)
+            return Z_MEM_ERROR;
+    }
+    return Z_OK;
+}
+#endif
+
+/* ===========================================================================
+ * Point the arrays of the Z_OPTIMAL work space into the memory that follows
+ * the structure, largest elements first so that each is aligned.
+ */
+local void opt_carve(opt)
+    opt_state *opt;
+{
+    ulg n = (ulg)opt->size + 1;
+
+    opt->cost = (ulg FAR *)(opt + 1);
+    opt->mlen = (ush FAR *)(opt->cost + n);
+    opt->mdist = opt->mlen + n * OPT_PAIRS;
+    opt->step = opt->mdist + n * OPT_PAIRS;
+    opt->sdist = opt->step + n;
+    opt->plen = opt->sdist + n;
+    opt->pdist = opt->plen + n;
+    opt->blen = opt->pdist + n;
+    opt->bdist = opt->blen + n;
+    opt->pairs = (uch FAR *)(opt->bdist + n);
+}
+
 /* ===========================================================================
  * Initialize the "longest match" routines for a new zlib stream
  */
@@ -1108,7 +1509,9 @@ local void lm_init (s)
 {
     s->window_size = (ulg)2L*s->w_size;
 
-    CLEAR_HASH(s);
+    if (s->head != Z_NULL) {
+        CLEAR_HASH(s);
+    }
 
     /* Set the default configuration parameters:
      */
@@ -1116,6 +1519,7 @@ local void lm_init (s)
     s->good_match       = configuration_table[s->level].good_length;
     s->nice_match       = configuration_table[s->level].nice_length;
     s->max_chain_length = configuration_table[s->level].max_chain;
+    s->match_tree = USE_TREE(s, s->level, s->strategy);
 
     s->strstart = 0;
     s->block_start = 0L;
@@ -1124,6 +1528,8 @@ local void lm_init (s)
     s->match_length = s->prev_length = MIN_MATCH-1;
     s->match_available = 0;
     s->ins_h = 0;
+    if (s->opt != Z_NULL)
+        s->opt->count = 0;
 #ifndef FASTEST
 #ifdef ASMV
     match_init(); /* initialize the asm code */
@@ -1131,6 +1537,48 @@ local void lm_init (s)
 #endif
 }
 
+/* ===========================================================================
+ * On 64-bit little-endian processors with fast unaligned loads, the match
+ * routines compare eight bytes at a time and locate the first mismatch from
+ * the trailing zero bits of the exclusive-or, and check the two bytes at the
+ * end of the best match so far with a single load.  Define NO_MATCH_WORDS to
+ * use the byte-at-a-time comparisons instead.
+ */
+#if !defined(ASMV) && !defined(NO_MATCH_WORDS) && defined(__GNUC__) && \
+    defined(Z_U8) && defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#  define MATCH_WORDS
+#endif
+
+#ifdef MATCH_WORDS
+local uInt match_extend OF((Bytef *scan, Bytef *match));
+
+/* Load two bytes from a possibly unaligned address */
+#define LOAD2(p, v) zmemcpy(&(v), p, 2)
+
+/* ===========================================================================
+ * Return the length of the common prefix of scan and match, given that their
+ * first two bytes are equal, up to MAX_MATCH.  This reads exactly MAX_MATCH
+ * bytes of each, like the byte-at-a-time loop it replaces.
+ */
+local uInt match_extend(scan, match)
+    Bytef *scan;
+    Bytef *match;
+{
+    uInt len;
+    Z_U8 a, b;
+
+    for (len = 2; len < MAX_MATCH; len += 8) {
+        zmemcpy(&a, scan + len, 8);
+        zmemcpy(&b, match + len, 8);
+        if (a != b)
+            return len + (uInt)(__builtin_ctzll(a ^ b) >> 3);
+    }
+    return MAX_MATCH;
+}
+#endif /* MATCH_WORDS */
+
 #ifndef FASTEST
 /* ===========================================================================
  * Set match_start to the longest match starting at the given string and
@@ -1163,7 +1611,9 @@ local uInt longest_match(s, cur_match)
     Posf *prev = s->prev;
     uInt wmask = s->w_mask;
 
-#ifdef UNALIGNED_OK
+#ifdef MATCH_WORDS
+    ush scan_start, scan_end, match_start, match_end;
+#elif defined(UNALIGNED_OK)
     /* Compare two bytes at a time. Note: this is not always beneficial.
      * Try with and without -DUNALIGNED_OK to check.
      */
@@ -1192,6 +1642,10 @@ local uInt longest_match(s, cur_match)
 
     Assert((ulg)s->strstart <= s->window_size-MIN_LOOKAHEAD, "need lookahead");
 
+#ifdef MATCH_WORDS
+    LOAD2(scan, scan_start);
+    LOAD2(scan + best_len - 1, scan_end);
+#endif
     do {
         Assert(cur_match < s->strstart, "no future");
         match = s->window + cur_match;
@@ -1204,7 +1658,17 @@ local uInt longest_match(s, cur_match)
          * However the length of the match is limited to the lookahead, so
          * the output of deflate is not affected by the uninitialized values.
          */
-#if (defined(UNALIGNED_OK) && MAX_MATCH == 258)
+#ifdef MATCH_WORDS
+        LOAD2(match + best_len - 1, match_end);
+        LOAD2(match, match_start);
+        if (match_end != scan_end || match_start != scan_start) continue;
+
+        /* Compare from the third byte on, which also takes care of scan[2]
+         * when the hash keys do not guarantee it.
+         */
+        len = (int)match_extend(scan, match);
+
+#elif (defined(UNALIGNED_OK) && MAX_MATCH == 258)
         /* This code assumes sizeof(unsigned short) == 2. Do not use
          * UNALIGNED_OK if your compiler uses a different size.
          */
@@ -1220,6 +1684,7 @@ local uInt longest_match(s, cur_match)
          * necessary to put more guard bytes at the end of the window, or
          * to check more often for insufficient lookahead.
          */
+        if (s->hash_crc && scan[2] != match[2]) continue;
         Assert(scan[2] == match[2], "scan[2]?");
         scan++, match++;
         do {
@@ -1248,8 +1713,10 @@ local uInt longest_match(s, cur_match)
          * again later. (This heuristic is not always a win.)
          * It is not necessary to compare scan[2] and match[2] since they
          * are always equal when the other bytes match, given that
-         * the hash keys are equal and that HASH_BITS >= 8.
+         * the hash keys are equal and that HASH_BITS >= 8.  That does not
+         * hold for the CRC hash, so then it is checked here.
          */
+        if (s->hash_crc && match[1] != scan[2]) continue;
         scan += 2, match++;
         Assert(*scan == *match, "match[2]?");
 
@@ -1274,7 +1741,9 @@ local uInt longest_match(s, cur_match)
             s->match_start = cur_match;
             best_len = len;
             if (len >= nice_match) break;
-#ifdef UNALIGNED_OK
+#ifdef MATCH_WORDS
+            LOAD2(scan + best_len - 1, scan_end);
+#elif defined(UNALIGNED_OK)
             scan_end = *(ushf*)(scan+best_len-1);
 #else
             scan_end1  = scan[best_len-1];
@@ -1289,6 +1758,114 @@ local uInt longest_match(s, cur_match)
 }
 #endif /* ASMV */
 
+/* ===========================================================================
+ * Insert the string str in the binary tree whose root is cur_match, the old
+ * head for its hash, and return the length of the longest match passed on
+ * the way, or MIN_MATCH-1 if none.  If start is not null, the position of
+ * that match is put there.  end is the end of the valid data in the window.
+ *
+ * Going down from the root, each node is compared with str and put on the
+ * left or the right of str, which becomes the new root, and the search goes
+ * on into its subtree on the side of str.  Every string between the last
+ * nodes put on each side has at least the shorter of their common prefixes
+ * with str, so the comparisons start there.  A node that is equal to str
+ * over nice_match bytes is replaced by str, and the match with it extended
+ * up to MAX_MATCH if start is not null.  The search stops there, after
+ * max_chain_length nodes, or when the next node is too far back, which cuts
+ * off what is left below.  Strings near the end of the data before a flush
+ * are compared over fewer bytes, so the tree can be a little out of order,
+ * which is why the prefix of a new longest match is checked before it is
+ * used.
+ * IN assertion: str + MIN_MATCH <= end
+ */
+local uInt tree_match(s, str, cur_match, end, start)
+    deflate_state *s;
+    IPos str;                                   /* string to insert */
+    IPos cur_match;                             /* root of the tree */
+    uInt end;                                   /* end of the data */
+    IPos *start;                                /* match position, or null */
+{
+    Bytef *scan = s->window + str;              /* string to insert */
+    Bytef *match;                               /* string at current node */
+    Posf *prev = s->prev;                       /* left subtrees */
+    Posf *right = s->right;                     /* right subtrees */
+    uInt wmask = s->w_mask;
+    Posf *less = &prev[str & wmask];            /* link for next left node */
+    Posf *more = &right[str & wmask];           /* link for next right node */
+    uInt len_less = 0, len_more = 0;            /* their common prefixes */
+    uInt len, skip;
+    uInt best = MIN_MATCH-1;                    /* longest match so far */
+    IPos best_match = NIL;                      /* where it is */
+    unsigned depth = s->max_chain_length;       /* nodes left to visit */
+    uInt nice = (uInt)s->nice_match;            /* bytes to compare */
+    IPos limit = str > (IPos)MAX_DIST(s) ? str - (IPos)MAX_DIST(s) : NIL;
+#ifdef MATCH_WORDS
+    Z_U8 a, b;
+#endif
+
+    Assert(str + MIN_MATCH <= end, "short string");
+    if (nice > end - str) nice = end - str;
+    for (;;) {
+        if (cur_match <= limit || depth-- == 0) {
+            *less = *more = NIL;
+            break;
+        }
+        Assert(cur_match < str, "no future");
+        match = s->window + cur_match;
+        len = skip = len_less < len_more ? len_less : len_more;
+#ifdef MATCH_WORDS
+        for (;;) {
+            zmemcpy(&a, match + len, 8);
+            zmemcpy(&b, scan + len, 8);
+            if (a != b) {
+                len += (uInt)(__builtin_ctzll(a ^ b) >> 3);
+                break;
+            }
+            len += 8;
+            if (len >= nice)
+                break;
+        }
+        if (len > nice)
+            len = nice;
+#else
+        while (len < nice && match[len] == scan[len])
+            len++;
+#endif
+        if (len > best &&
+            (skip == 0 || zmemcmp(match, scan, skip) == EQUAL)) {
+            best = len;
+            best_match = cur_match;
+        }
+        if (len == nice) {
+            *less = prev[cur_match & wmask];
+            *more = right[cur_match & wmask];
+            break;
+        }
+        if (match[len] < scan[len]) {
+            *less = cur_match;
+            less = &right[cur_match & wmask];
+            cur_match = *less;
+            len_less = len;
+        }
+        else {
+            *more = cur_match;
+            more = &prev[cur_match & wmask];
+            cur_match = *more;
+            len_more = len;
+        }
+    }
+    if (best == nice && start != Z_NULL) {
+        /* extend the match found beyond nice_match */
+        nice = end - str < MAX_MATCH ? end - str : MAX_MATCH;
+        match = s->window + best_match;
+        while (best < nice && match[best] == scan[best])
+            best++;
+    }
+    if (start != Z_NULL)
+        *start = best_match;
+    return best;
+}
+
 #else /* FASTEST */
 
 /* ---------------------------------------------------------------------------
@@ -1301,7 +1878,9 @@ local uInt longest_match(s, cur_match)
     register Bytef *scan = s->window + s->strstart; /* current string */
     register Bytef *match;                       /* matched string */
     register int len;                           /* length of current match */
+#ifndef MATCH_WORDS
     register Bytef *strend = s->window + s->strstart + MAX_MATCH;
+#endif
 
     /* The code is optimized for HASH_BITS >= 8 and MAX_MATCH-2 multiple of 16.
      * It is easy to get rid of this optimization if necessary.
@@ -1324,6 +1903,10 @@ local uInt longest_match(s, cur_match)
      * are always equal when the other bytes match, given that
      * the hash keys are equal and that HASH_BITS >= 8.
      */
+#ifdef MATCH_WORDS
+    len = (int)match_extend(scan, match);
+#else
+    if (s->hash_crc && match[2] != scan[2]) return MIN_MATCH-1;
     scan += 2, match += 2;
     Assert(*scan == *match, "match[2]?");
 
@@ -1340,6 +1923,7 @@ local uInt longest_match(s, cur_match)
     Assert(scan <= s->window+(unsigned)(s->window_size-1), "wild scan");
 
     len = MAX_MATCH - (int)(strend - scan);
+#endif
 
     if (len < MIN_MATCH) return MIN_MATCH - 1;
 
@@ -1397,6 +1981,14 @@ local void fill_window(s)
 
     Assert(s->lookahead < MIN_LOOKAHEAD, "already enough lookahead");
 
+    /* Once all of the input is in the window, there is nothing to do until
+     * the window needs to slide.  This is the case for every position of the
+     * last MIN_LOOKAHEAD bytes, and for all of a short single-shot input.
+     * The zeroing below was already done when the input was read.
+     */
+    if (s->strm->avail_in == 0 && s->strstart < wsize+MAX_DIST(s))
+        return;
+
     do {
         more = (unsigned)(s->window_size -(ulg)s->lookahead -(ulg)s->strstart);
 
@@ -1436,16 +2028,26 @@ local void fill_window(s)
                 *p = (Pos)(m >= wsize ? m-wsize : NIL);
             } while (--n);
 
-            n = wsize;
 #ifndef FASTEST
-            p = &s->prev[n];
-            do {
-                m = *--p;
-                *p = (Pos)(m >= wsize ? m-wsize : NIL);
-                /* If n is not on any hash chain, prev[n] is garbage but
-                 * its value will never be used.
-                 */
-            } while (--n);
+            if (s->strategy != Z_QUICK) {   /* Z_QUICK does not use prev[] */
+                n = wsize;
+                p = &s->prev[n];
+                do {
+                    m = *--p;
+                    *p = (Pos)(m >= wsize ? m-wsize : NIL);
+                    /* If n is not on any hash chain, prev[n] is garbage but
+                     * its value will never be used.
+                     */
+                } while (--n);
+            }
+            if (s->match_tree) {
+                n = wsize;
+                p = &s->right[n];
+                do {
+                    m = *--p;
+                    *p = (Pos)(m >= wsize ? m-wsize : NIL);
+                } while (--n);
+            }
 #endif
             more += wsize;
         }
@@ -1476,9 +2078,12 @@ local void fill_window(s)
             Call UPDATE_HASH() MIN_MATCH-3 more times
 #endif
             while (s->insert) {
-                UPDATE_HASH(s, s->ins_h, s->window[str + MIN_MATCH-1]);
+                UPDATE_HASH_STR(s, str);
 #ifndef FASTEST
                 s->prev[str & s->w_mask] = s->head[s->ins_h];
+                if (s->match_tree)
+                    tree_match(s, str, s->prev[str & s->w_mask],
+                               s->strstart + s->lookahead, Z_NULL);
 #endif
                 s->head[s->ins_h] = (Pos)str;
                 str++;
@@ -1732,6 +2337,9 @@ local block_state deflate_slow(s, flush)
     int flush;
 {
     IPos hash_head;          /* head of hash chain */
+    uInt best;               /* longest match from binary tree */
+    IPos dup;                /* end of the strings that repeat dist back */
+    uInt dist;               /* distance of the match being output */
     int bflush;              /* set if current block must be flushed */
 
     /* Process the input block. */
@@ -1762,7 +2370,19 @@ local block_state deflate_slow(s, flush)
         s->prev_length = s->match_length, s->prev_match = s->match_start;
         s->match_length = MIN_MATCH-1;
 
-        if (hash_head != NIL && s->prev_length < s->max_lazy_match &&
+        if (s->match_tree) {
+            /* Insert the string in the binary tree, which finds the longest
+             * match at the same time.  This is done even when the match is
+             * not wanted, to keep the tree whole.
+             */
+            if (s->lookahead >= MIN_MATCH) {
+                best = tree_match(s, s->strstart, hash_head,
+                                  s->strstart + s->lookahead, &s->match_start);
+                if (s->prev_length < s->max_lazy_match)
+                    s->match_length = best;
+            }
+        }
+        else if (hash_head != NIL && s->prev_length < s->max_lazy_match &&
             s->strstart - hash_head <= MAX_DIST(s)) {
             /* To simplify the code, we prevent matches with the string
              * of window index 0 (in particular we have to avoid a match
@@ -1770,7 +2390,8 @@ local block_state deflate_slow(s, flush)
              */
             s->match_length = longest_match (s, hash_head);
             /* longest_match() sets match_start */
-
+        }
+        if (s->match_length > MIN_MATCH-1) {
             if (s->match_length <= 5 && (s->strategy == Z_FILTERED
 #if TOO_FAR <= 32767
                 || (s->match_length == MIN_MATCH &&
@@ -1801,11 +2422,40 @@ local block_state deflate_slow(s, flush)
              * enough lookahead, the last two strings are not inserted in
              * the hash table.
              */
+            dist = s->strstart - 1 - s->prev_match;
+            dup = s->strstart;
+            if (s->match_tree) {
+                /* Find the strings in the match that are equal over
+                 * nice_match bytes to the strings dist back.  Where the one
+                 * dist back is the root, the tree would replace it by the
+                 * new string after comparing them, so that is done directly.
+                 * This makes the insertions in long runs cheap.
+                 */
+                Bytef *scan = s->window + s->strstart - 1 + s->prev_length;
+                Bytef *match = scan - dist;
+                Bytef *strend = s->window + max_insert + MIN_MATCH;
+
+                if (strend > scan + s->nice_match)
+                    strend = scan + s->nice_match;
+                while (scan < strend && *scan == *match)
+                    scan++, match++;
+                if ((uInt)(scan - s->window) > s->strstart + s->nice_match)
+                    dup = (IPos)(scan - s->window) + 1 - s->nice_match;
+            }
             s->lookahead -= s->prev_length-1;
             s->prev_length -= 2;
             do {
                 if (++s->strstart <= max_insert) {
                     INSERT_STRING(s, s->strstart, hash_head);
+                    if (s->strstart < dup && hash_head == s->strstart - dist) {
+                        s->prev[s->strstart & s->w_mask] =
+                            s->prev[hash_head & s->w_mask];
+                        s->right[s->strstart & s->w_mask] =
+                            s->right[hash_head & s->w_mask];
+                    }
+                    else if (s->match_tree)
+                        tree_match(s, s->strstart, hash_head,
+                                   max_insert + MIN_MATCH, Z_NULL);
                 }
             } while (--s->prev_length != 0);
             s->match_available = 0;
@@ -1851,6 +2501,296 @@ local block_state deflate_slow(s, flush)
         FLUSH_BLOCK(s, 0);
     return block_done;
 }
+
+/* ===========================================================================
+ * Find the matches at strstart for Z_OPTIMAL.  The hash chain from cur_match
+ * is followed as in longest_match(), but each match that is longer than those
+ * before it is kept, up to OPT_PAIRS of them, in len[] and dist[].  Since the
+ * chain goes from near to far, that is the closest match of each length,
+ * which has the cheapest distance code.  When more are found, the last one
+ * kept is replaced.  Return the number of matches.
+ */
+local uInt opt_matches(s, cur_match, len, dist)
+    deflate_state *s;
+    IPos cur_match;                             /* current match */
+    ushf *len;                                  /* lengths of the matches */
+    ushf *dist;                                 /* distances of the matches */
+{
+    unsigned chain_length = s->max_chain_length;/* max hash chain length */
+    register Bytef *scan = s->window + s->strstart; /* current string */
+    register Bytef *match;                      /* matched string */
+    uInt here;                                  /* length of current match */
+    uInt best = MIN_MATCH-1;                    /* longest match so far */
+    uInt nice = (uInt)s->nice_match;            /* stop if match long enough */
+    uInt n = 0;                                 /* number of matches kept */
+    IPos limit = s->strstart > (IPos)MAX_DIST(s) ?
+        s->strstart - (IPos)MAX_DIST(s) : NIL;
+    Posf *prev = s->prev;
+    uInt wmask = s->w_mask;
+
+    if (nice > s->lookahead) nice = s->lookahead;
+
+    do {
+        match = s->window + cur_match;
+        if (match[best] != scan[best] || match[0] != scan[0] ||
+            match[1] != scan[1]) continue;
+
+#ifdef MATCH_WORDS
+        here = match_extend(scan, match);
+#else
+        here = 2;
+        while (here < MAX_MATCH && scan[here] == match[here])
+            here++;
+#endif
+        if (here > s->lookahead) here = s->lookahead;
+        if (here <= best) continue;
+
+        check_match(s, s->strstart, cur_match, here);
+        if (n == OPT_PAIRS) n--;
+        len[n] = (ush)here;
+        dist[n++] = (ush)(s->strstart - cur_match);
+        best = here;
+        if (best >= nice) break;
+    } while ((cur_match = prev[cur_match & wmask]) > limit
+             && --chain_length != 0);
+    return n;
+}
+
+/* ===========================================================================
+ * Find the parse of the last n positions gathered for Z_OPTIMAL with the
+ * least total cost, given the bit costs of the literal/length codes in lcost[]
+ * and of the distance codes in dcost[], and leave it in plen[] and pdist[].
+ * This is a shortest path from the first position to the end of the block,
+ * where each position is reached either by a literal from the one before, or
+ * by a match of any length up to those found at an earlier position.
+ */
+local void opt_parse(s, n, lcost, dcost)
+    deflate_state *s;
+    uInt n;
+    uch *lcost;
+    uch *dcost;
+{
+    opt_state *opt = s->opt;
+    Bytef *base = s->window + s->strstart - n;  /* first position */
+    ushf *len, *dist;       /* matches at the current position */
+    ulg cost;               /* least cost to reach the current position */
+    ulg here;               /* cost of the current match's distance */
+    ulg next;               /* cost of reaching a later position */
+    uInt j;                 /* current position */
+    uInt m;                 /* current match */
+    uInt k;                 /* length of a step */
+    uInt max;               /* longest step from the current match */
+    uch lencost[MAX_MATCH+1]; /* bit cost of each match length */
+
+    for (k = MIN_MATCH; k <= MAX_MATCH; k++)
+        lencost[k] = lcost[_length_code[k - MIN_MATCH] + LITERALS + 1];
+    opt->cost[0] = 0;
+    for (j = 1; j <= n; j++)
+        opt->cost[j] = ~(ulg)0;
+
+    for (j = 0; j < n; j++) {
+        cost = opt->cost[j];
+        next = cost + lcost[base[j]];
+        if (next < opt->cost[j + 1]) {
+            opt->cost[j + 1] = next;
+            opt->step[j + 1] = 1;
+            opt->sdist[j + 1] = 0;
+        }
+
+        /* each match covers the lengths after the one before it */
+        len = opt->mlen + j * OPT_PAIRS;
+        dist = opt->mdist + j * OPT_PAIRS;
+        k = MIN_MATCH;
+        for (m = 0; m < opt->pairs[j]; m++) {
+            max = len[m] < n - j ? len[m] : n - j;
+            here = cost + dcost[d_code(dist[m] - 1)];
+            for (; k <= max; k++) {
+                next = here + lencost[k];
+                if (next < opt->cost[j + k]) {
+                    opt->cost[j + k] = next;
+                    opt->step[j + k] = (ush)k;
+                    opt->sdist[j + k] = dist[m];
+                }
+            }
+        }
+    }
+
+    /* follow the steps back from the end */
+    j = n;
+    while (j) {
+        k = opt->step[j];
+        j -= k;
+        opt->plen[j] = (ush)k;
+        opt->pdist[j] = opt->sdist[j + k];
+    }
+}
+
+/* ===========================================================================
+ * Make a greedy parse of the last n positions gathered for Z_OPTIMAL in plen[]
+ * and pdist[], using the longest match at each position with a distance of
+ * no more than far, or else a literal.
+ */
+local void opt_greedy(s, n, far)
+    deflate_state *s;
+    uInt n;
+    uInt far;
+{
+    opt_state *opt = s->opt;
+    uInt j;                 /* current position */
+    uInt m;                 /* number of matches at or within far */
+    uInt k;                 /* length of the step */
+
+    for (j = 0; j < n; j++) {
+        m = opt->pairs[j];
+        while (m && opt->mdist[j * OPT_PAIRS + m - 1] > far)
+            m--;
+        k = m ? opt->mlen[j * OPT_PAIRS + m - 1] : 1;
+        if (k > n - j) k = n - j;
+        if (k < MIN_MATCH) k = 1;
+        opt->plen[j] = (ush)k;
+        opt->pdist[j] = k == 1 ? 0 : opt->mdist[j * OPT_PAIRS + m - 1];
+    }
+}
+
+/* ===========================================================================
+ * Tally the parse in len[] and dist[] of the last n positions gathered for
+ * Z_OPTIMAL.  A length of one is a literal.  (The matches were checked when
+ * they were found, since the window may have slid since then.)
+ */
+local void opt_tally(s, n, len, dist)
+    deflate_state *s;
+    uInt n;
+    ushf *len;
+    ushf *dist;
+{
+    IPos start = s->strstart - n;   /* window position of the block */
+    uInt j;
+
+    for (j = 0; j < n; j += len[j]) {
+        if (len[j] == 1)
+            _tr_tally(s, 0, s->window[start + j]);
+        else
+            _tr_tally(s, dist[j], len[j] - MIN_MATCH);
+    }
+}
+
+/* ===========================================================================
+ * For Z_OPTIMAL, find the matches at every position of a segment of the input,
+ * and then choose the parse of the segment into literals and matches that
+ * codes to the fewest bits, along with the symbols already in the block.  The
+ * cost of each code is first taken from the Huffman codes for a greedy parse
+ * of the segment, and then from those for the previous parse, for up to
+ * OPT_ITERATIONS parses or until the parses stop changing.  Since that can
+ * settle on a parse that is not the best, this is done twice: starting from
+ * the longest matches, and starting from the longest matches within
+ * OPT_NEAR, which can lead to a parse with fewer, cheaper distance codes.
+ * The best parse is added to the block, which is ended once it has an eighth
+ * of a full segment's worth of symbols, so that very compressible data is not
+ * cut into blocks that are short next to their code descriptions.  The level
+ * sets the effort of the match search, as for the other strategies.  This is
+ * many times slower than level 9, for a few percent less output.
+ */
+#ifndef OPT_ITERATIONS
+#  define OPT_ITERATIONS 10
+#endif
+#ifndef OPT_NEAR
+#  define OPT_NEAR 256
+#endif
+
+local block_state deflate_optimal(s, flush)
+    deflate_state *s;
+    int flush;
+{
+    opt_state *opt = s->opt;
+    IPos hash_head;         /* head of the hash chain */
+    uInt most;              /* most positions in a segment */
+    uInt limit;             /* most positions in this segment */
+    uInt n;                 /* number of positions in the segment */
+    uInt keep;              /* number of symbols in the block before it */
+    int start;              /* which greedy parse to start from */
+    int i;                  /* parse iteration */
+    ulg bits;               /* bit length of the current parse */
+    ulg last;               /* bit length of the previous parse */
+    ulg best;               /* bit length of the best parse */
+    uch lcost[L_CODES];     /* bit costs of the literal/length codes */
+    uch dcost[D_CODES];     /* bit costs of the distance codes */
+
+    /* The data of a segment must stay in the window while it is gathered, and
+     * its symbols must fit in the rest of the literal buffer.
+     */
+    most = s->lit_bufsize - 1;
+    if (most > MAX_DIST(s)) most = MAX_DIST(s);
+    if (most > opt->size) most = opt->size;
+
+    for (;;) {
+        /* Find the matches at each position of the segment. */
+        limit = s->lit_bufsize - 1 - s->last_lit;
+        if (limit > most) limit = most;
+        while (opt->count < limit) {
+            if (s->lookahead < MIN_LOOKAHEAD) {
+                fill_window(s);
+                if (s->lookahead < MIN_LOOKAHEAD && flush == Z_NO_FLUSH) {
+                    return need_more;
+                }
+                if (s->lookahead == 0) break;   /* parse what there is */
+            }
+            opt->pairs[opt->count] = 0;
+            if (s->lookahead >= MIN_MATCH) {
+                INSERT_STRING(s, s->strstart, hash_head);
+                if (hash_head != NIL &&
+                    s->strstart - hash_head <= MAX_DIST(s))
+                    opt->pairs[opt->count] = (uch)opt_matches(s, hash_head,
+                        opt->mlen + opt->count * OPT_PAIRS,
+                        opt->mdist + opt->count * OPT_PAIRS);
+            }
+            opt->count++;
+            s->strstart++;
+            s->lookahead--;
+        }
+        n = opt->count;
+        if (n == 0) break;
+        keep = s->last_lit;
+
+        /* Parse with the costs of the codes for the previous parse, keeping
+           the best, starting from each of the greedy parses. */
+        best = ~(ulg)0;
+        for (start = 0; start < 2; start++) {
+            opt_greedy(s, n, start ? OPT_NEAR : MAX_DIST(s));
+            i = 0;
+            last = 0;
+            for (;;) {
+                opt_tally(s, n, opt->plen, opt->pdist);
+                bits = _tr_costs(s, keep, lcost, dcost);
+                if (bits < best) {
+                    best = bits;
+                    zmemcpy((Bytef *)opt->blen, (Bytef *)opt->plen,
+                            n * sizeof(ush));
+                    zmemcpy((Bytef *)opt->bdist, (Bytef *)opt->pdist,
+                            n * sizeof(ush));
+                }
+                if (bits == last || i++ == OPT_ITERATIONS)
+                    break;
+                last = bits;
+                opt_parse(s, n, lcost, dcost);
+            }
+        }
+
+        /* Add the best parse to the block. */
+        opt_tally(s, n, opt->blen, opt->bdist);
+        opt->count = 0;
+        if (n < limit) break;
+        if (s->last_lit >= most >> 3)
+            FLUSH_BLOCK(s, 0);
+    }
+    s->insert = s->strstart < MIN_MATCH-1 ? s->strstart : MIN_MATCH-1;
+    if (flush == Z_FINISH) {
+        FLUSH_BLOCK(s, 1);
+        return finish_done;
+    }
+    if (s->last_lit)
+        FLUSH_BLOCK(s, 0);
+    return block_done;
+}
 #endif /* FASTEST */
 
 /* ===========================================================================
@@ -1965,3 +2905,94 @@ local block_state deflate_huff(s, flush)
         FLUSH_BLOCK(s, 0);
     return block_done;
 }
+
+/* ===========================================================================
+ * For Z_QUICK, look for a match only at the most recent string with the same
+ * hash of four bytes, and emit it if found.  The hash table has just the one
+ * entry per hash value and prev[] is not maintained, and strings inside a
+ * match are not entered in the table.  This is faster than level 1, usually
+ * at some cost in compression.  (Since there are no hash chains, the hash
+ * table is cleared if deflate switches away from Z_QUICK.)
+ */
+#define QUICK_LOAD(p) \
+    ((ulg)(p)[0] | ((ulg)(p)[1] << 8) | ((ulg)(p)[2] << 16) | \
+     ((ulg)(p)[3] << 24))
+#define QUICK_HASH(s, v) \
+    ((uInt)((((v) * 2654435761UL) & 0xffffffffUL) >> (32 - (s)->hash_bits)))
+
+local block_state deflate_quick(s, flush)
+    deflate_state *s;
+    int flush;
+{
+    int bflush;             /* set if current block must be flushed */
+    ulg val;                /* four bytes at strstart */
+    uInt h;                 /* hash of val */
+    IPos cur_match;         /* last string with the same hash */
+    Bytef *scan, *match;    /* current string and its match */
+
+    for (;;) {
+        /* Make sure that we always have enough lookahead, except
+         * at the end of the input file. We need MAX_MATCH bytes
+         * for the next match.
+         */
+        if (s->lookahead < MIN_LOOKAHEAD) {
+            fill_window(s);
+            if (s->lookahead < MIN_LOOKAHEAD && flush == Z_NO_FLUSH) {
+                return need_more;
+            }
+            if (s->lookahead == 0) break; /* flush the current block */
+        }
+
+        /* Look up and replace the last string with this hash, and emit a
+         * match with it if its first four bytes are the same
+         */
+        s->match_length = 0;
+        if (s->lookahead >= 4) {
+            scan = s->window + s->strstart;
+            val = QUICK_LOAD(scan);
+            h = QUICK_HASH(s, val);
+            cur_match = s->head[h];
+            s->head[h] = (Pos)s->strstart;
+            match = s->window + cur_match;
+            if (cur_match != NIL &&
+                s->strstart - cur_match <= MAX_DIST(s) &&
+                QUICK_LOAD(match) == val) {
+#ifdef MATCH_WORDS
+                s->match_length = match_extend(scan, match);
+#else
+                s->match_length = 4;
+                while (s->match_length < MAX_MATCH &&
+                       scan[s->match_length] == match[s->match_length])
+                    s->match_length++;
+#endif
+                if (s->match_length > s->lookahead)
+                    s->match_length = s->lookahead;
+                check_match(s, s->strstart, cur_match, s->match_length);
+
+                _tr_tally_dist(s, s->strstart - cur_match,
+                               s->match_length - MIN_MATCH, bflush);
+
+                s->lookahead -= s->match_length;
+                s->strstart += s->match_length;
+                s->match_length = 0;
+                if (bflush) FLUSH_BLOCK(s, 0);
+                continue;
+            }
+        }
+
+        /* No match, output a literal byte */
+        Tracevv((stderr,"%c", s->window[s->strstart]));
+        _tr_tally_lit (s, s->window[s->strstart], bflush);
+        s->lookahead--;
+        s->strstart++;
+        if (bflush) FLUSH_BLOCK(s, 0);
+    }
+    s->insert = 0;
+    if (flush == Z_FINISH) {
+        FLUSH_BLOCK(s, 1);
+        return finish_done;
+    }
+    if (s->last_lit)
+        FLUSH_BLOCK(s, 0);
+    return block_done;
+}
@@ -48,8 +48,23 @@
 #define MAX_BITS 15
 /* All codes must not exceed MAX_BITS bits */
 
-#define Buf_size 16
-/* size of bit buffer in bi_buf */
+/* On 64-bit machines the bit buffer holds 64 bits, and is written to
+   pending_buf eight bytes at a time.  Define NO_BI_WORDS to use a 16-bit
+   bit buffer instead. */
+#if defined(Z_U8) && !defined(NO_BI_WORDS) && \
+    ((defined(ULONG_MAX) && ULONG_MAX == 0xffffffffffffffff) || \
+     defined(_WIN64))
+#  define BI_WORDS
+#endif
+
+#ifdef BI_WORDS
+   typedef Z_U8 bi_word;
+#  define Buf_size 64
+#else
+   typedef ush bi_word;
+#  define Buf_size 16
+#endif
+/* type and size of bit buffer in bi_buf */
 
 #define INIT_STATE    42
 #define EXTRA_STATE   69
@@ -94,6 +109,34 @@ typedef unsigned IPos;
  * save space in the various tables. IPos is used only for parameter passing.
  */
 
+#define OPT_PAIRS 8
+/* Number of matches kept at each position for Z_OPTIMAL, each longer and
+ * farther than the one before.
+ */
+
+/* Work space for the Z_OPTIMAL parse of a segment of the input.  The arrays
+ * are allocated with the structure, in one piece of memory, and indexed by the
+ * position in the segment.
+ */
+typedef struct opt_state_s {
+    uInt size;           /* number of positions there is room for */
+    uInt count;          /* positions gathered for the next segment */
+    ulg  FAR *cost;      /* least bit cost to reach each position */
+    ush  FAR *mlen;      /* OPT_PAIRS match lengths at each position */
+    ush  FAR *mdist;     /* and their distances */
+    ush  FAR *step;      /* length of the last step to each position */
+    ush  FAR *sdist;     /* and its distance, or zero for a literal */
+    ush  FAR *plen;      /* parse: length of the step at each position */
+    ush  FAR *pdist;     /* and its distance */
+    ush  FAR *blen;      /* least cost parse found so far */
+    ush  FAR *bdist;
+    uch  FAR *pairs;     /* number of matches at each position */
+} FAR opt_state;
+
+#define OPT_BYTES(n) (sizeof(opt_state) + ((ulg)(n) + 1) * \
+    (sizeof(ulg) + (2*OPT_PAIRS + 6) * sizeof(ush) + 1))
+/* Number of bytes of memory for an opt_state with room for n positions. */
+
 typedef struct internal_state {
     z_streamp strm;      /* pointer back to this zlib stream */
     int   status;        /* as the name implies */
@@ -134,6 +177,13 @@ typedef struct internal_state {
      * An index in this array is thus a window index modulo 32K.
      */
 
+    Posf *right;
+    /* For the binary tree match finder, prev[] and right[] are instead the
+     * subtrees of the strings that sort before and after the string at each
+     * window index, and head[] holds the root of the tree for each hash.  The
+     * tree is searched and the string inserted at the same time.
+     */
+
     Posf *head; /* Heads of the hash chains or NIL. */
 
     uInt  ins_h;          /* hash index of string to be inserted */
@@ -148,6 +198,12 @@ typedef struct internal_state {
      *   hash_shift * MIN_MATCH >= hash_bits
      */
 
+    int hash_crc;
+    /* True if ins_h is computed with the processor's CRC instruction on the
+     * four bytes at each string, instead of rolling it over MIN_MATCH bytes.
+     * Requested with Z_HASH_CRC in the strategy for deflateInit2_().
+     */
+
     long block_start;
     /* Window position at the beginning of the current output block. Gets
      * negative when the window is moved backwards.
@@ -168,7 +224,17 @@ typedef struct internal_state {
     uInt max_chain_length;
     /* To speed up deflation, hash chains are never searched beyond this
      * length.  A higher limit improves compression ratio but degrades the
-     * speed.
+     * speed.  This is also the depth limit of the binary trees.
+     */
+
+    int tree_ok;
+    /* True if Z_MATCH_TREE was given in the strategy for deflateInit2_(), so
+     * that the levels marked tree in configuration_table use binary trees.
+     */
+
+    int match_tree;
+    /* True if deflate_slow() finds its matches with the binary trees in
+     * prev[] and right[] instead of with the hash chains.  Set by the level.
      */
 
     uInt max_lazy_match;
@@ -247,6 +313,12 @@ typedef struct internal_state {
     ulg opt_len;        /* bit length of current block with optimal trees */
     ulg static_len;     /* bit length of current block with static trees */
     uInt matches;       /* number of string matches in current block */
+    uInt split_at;      /* last_lit at which to check for the end of a block */
+    ulg split_cost;     /* estimated 1/256 bits of the block at last check */
+    ush split_freq[L_CODES+D_CODES];
+    /* Literal/length and distance frequencies at the last check, to see how
+     * the symbols since then differ from the block before them.
+     */
     uInt insert;        /* bytes at end of window left to insert */
 
 #ifdef DEBUG
@@ -254,7 +326,7 @@ typedef struct internal_state {
     ulg bits_sent;      /* bit length of compressed data sent mod 2^32 */
 #endif
 
-    ush bi_buf;
+    bi_word bi_buf;
     /* Output buffer. bits are inserted starting at the bottom (least
      * significant bits).
      */
@@ -270,6 +342,12 @@ typedef struct internal_state {
      * updated to the new high water mark.
      */
 
+    opt_state *opt;
+    /* Matches and parse of the block being gathered for Z_OPTIMAL, or Z_NULL
+     * if that strategy has not been used.  Allocated by deflate() when first
+     * needed.
+     */
+
 } FAR deflate_state;
 
 /* Output a byte on the stream.
@@ -292,6 +370,11 @@ typedef struct internal_state {
 /* Number of bytes after end of data in window to initialize in order to avoid
    memory checker errors from longest match routines */
 
+#define WIN_PAD 4
+/* Number of extra elements of two bytes allocated (and zeroed) after the
+   window, so that a four-byte hash can be read at the last string of a full
+   window */
+
         /* in trees.c */
 void ZLIB_INTERNAL _tr_init OF((deflate_state *s));
 int ZLIB_INTERNAL _tr_tally OF((deflate_state *s, unsigned dist, unsigned lc));
@@ -301,6 +384,9 @@ void ZLIB_INTERNAL _tr_flush_bits OF((deflate_state *s));
 void ZLIB_INTERNAL _tr_align OF((deflate_state *s));
 void ZLIB_INTERNAL _tr_stored_block OF((deflate_state *s, charf *buf,
                         ulg stored_len, int last));
+ulg ZLIB_INTERNAL _tr_costs OF((deflate_state *s, unsigned keep, uch *lcost,
+                        uch *dcost));
+int ZLIB_INTERNAL _tr_split OF((deflate_state *s));
 
 #define d_code(dist) \
    ((dist) < 256 ? _dist_code[dist] : _dist_code[256+((dist)>>7)])
@@ -309,9 +395,6 @@ void ZLIB_INTERNAL _tr_stored_block OF((deflate_state *s, charf *buf,
  * used.
  */
 
-#ifndef DEBUG
-/* Inline versions of _tr_tally for speed: */
-
 #if defined(GEN_TREES_H) || !defined(STDC)
   extern uch ZLIB_INTERNAL _length_code[];
   extern uch ZLIB_INTERNAL _dist_code[];
@@ -320,12 +403,15 @@ void ZLIB_INTERNAL _tr_stored_block OF((deflate_state *s, charf *buf,
   extern const uch ZLIB_INTERNAL _dist_code[];
 #endif
 
+#ifndef DEBUG
+/* Inline versions of _tr_tally for speed: */
+
 # define _tr_tally_lit(s, c, flush) \
   { uch cc = (c); \
     s->d_buf[s->last_lit] = 0; \
     s->l_buf[s->last_lit++] = cc; \
     s->dyn_ltree[cc].Freq++; \
-    flush = (s->last_lit == s->lit_bufsize-1); \
+    flush = (s->last_lit == s->split_at && _tr_split(s)); \
    }
 # define _tr_tally_dist(s, distance, length, flush) \
   { uch len = (length); \
@@ -335,7 +421,7 @@ void ZLIB_INTERNAL _tr_stored_block OF((deflate_state *s, charf *buf,
     dist--; \
     s->dyn_ltree[_length_code[len]+LITERALS+1].Freq++; \
     s->dyn_dtree[d_code(dist)].Freq++; \
-    flush = (s->last_lit == s->lit_bufsize-1); \
+    flush = (s->last_lit == s->split_at && _tr_split(s)); \
   }
 #else
 # define _tr_tally_lit(s, c, flush) flush = _tr_tally(s, 0, c)
@@ -35,6 +35,14 @@
 #  include <io.h>
 #endif
 
+/* USE_MMAP maps input files for reading where there is mmap() */
+#if defined(USE_MMAP) && (!defined(_WIN32) || defined(__CYGWIN__))
+#  define GZ_MMAP
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
 #ifdef WINAPI_FAMILY
 #  define open _open
 #  define read _read
@@ -108,6 +116,17 @@
 #endif
 /* compile with -Dlocal if your debugger can't find static symbols */
 
+/* seek with 64-bit offsets where available */
+#if defined(_WIN32) && !defined(__BORLANDC__)
+#  define LSEEK _lseeki64
+#else
+#if defined(_LARGEFILE64_SOURCE) && _LFS64_LARGEFILE-0
+#  define LSEEK lseek64
+#else
+#  define LSEEK lseek
+#endif
+#endif
+
 /* gz* functions always use library allocation functions */
 #ifndef STDC
   extern voidp  malloc OF((uInt size));
@@ -133,6 +152,8 @@
     ZEXTERN z_off64_t ZEXPORT gzseek64 OF((gzFile, z_off64_t, int));
     ZEXTERN z_off64_t ZEXPORT gztell64 OF((gzFile));
     ZEXTERN z_off64_t ZEXPORT gzoffset64 OF((gzFile));
+    ZEXTERN int ZEXPORT gzindex_read64 OF((gzIndex, int, z_off64_t,
+                                           voidp, unsigned));
 #endif
 
 /* default memLevel */
@@ -157,6 +178,16 @@
 #define COPY 1      /* copy input directly */
 #define GZIP 2      /* decompress a gzip stream */
 
+/* access point for seeking while reading, recorded at a deflate block
+   boundary as in examples/zran.c */
+typedef struct {
+    z_off64_t in;           /* offset in file of the first full byte */
+    z_off64_t out;          /* corresponding offset in uncompressed data */
+    int bits;               /* number of bits (1-7) from byte at in - 1, or 0 */
+    unsigned wsize;         /* length of the preceding history in window */
+    unsigned char *window;  /* preceding history, up to 32K */
+} gz_point;
+
 /* internal gzip file state data structure */
 typedef struct {
         /* exposed contents for gzgetc() macro */
@@ -178,6 +209,17 @@ typedef struct {
     z_off64_t start;        /* where the gzip data started, for rewinding */
     int eof;                /* true if end of input file reached */
     int past;               /* true if read requested past end */
+    int raw;                /* true if in a member entered at an access point */
+    unsigned trail;         /* trailer bytes to skip after such a member */
+    unsigned long span;     /* distance between access points, 0 for none */
+    gz_point *points;       /* access points recorded so far */
+    unsigned npoints;       /* number of access points */
+    unsigned maxpoints;     /* number of access points allocated */
+#ifdef GZ_MMAP
+    int mapok;              /* true if 'm' in the mode allows mapping */
+    unsigned char *map;     /* input file mapped in memory, or NULL */
+    z_off64_t maplen;       /* length of the mapping */
+#endif
         /* just for writing */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
@@ -194,6 +236,7 @@ typedef gz_state FAR *gz_statep;
 
 /* shared functions */
 void ZLIB_INTERNAL gz_error OF((gz_statep, int, const char *));
+int ZLIB_INTERNAL gz_jump OF((gz_statep, z_off64_t));
 #if defined UNDER_CE
 char ZLIB_INTERNAL *gz_strwinerror OF((DWORD error));
 #endif
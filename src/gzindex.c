@@ -0,0 +1,612 @@
+/* gzindex.c -- zlib functions for random access into gzip and zlib files
+ * Copyright (C) 1995-2013 Jean-loup Gailly and Mark Adler
+ * Based on examples/zran.c, Copyright (C) 2005, 2012 Mark Adler
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+   This is the method of examples/zran.c made into library functions.  One
+   pass decompresses the whole stream with Z_BLOCK, and at the end of a deflate
+   block about every span bytes of output an access point is recorded: the
+   offset of the block in the compressed data (byte and bit), its offset in the
+   uncompressed data, and the 32K of output that precedes it.  To read at an
+   offset, inflate is started at the last access point at or before it, primed
+   with the leftover bits using inflatePrime() and the history using
+   inflateSetDictionary(), and decompresses at most span bytes to get there.
+
+   The saved windows are themselves compressed with deflate, both in memory
+   and in the index file written by gzindex_save(), so an index costs around
+   10K per access point for typical data instead of 32K.
+
+   The index file is little-endian and consists of:
+
+     4 bytes    "GZIX"
+     1 byte     format version, 1
+     4 bytes    number of access points
+     8 bytes    length of the uncompressed data
+     8 bytes    span used when building
+     then for each access point:
+       8 bytes  offset of the first full byte in the compressed input
+       8 bytes  offset in the uncompressed data
+       1 byte   number of bits (0..7) to use from the byte before that
+       2 bytes  length of the history, 0..32768
+       4 bytes  length of the compressed history
+       the compressed history, as raw deflate data
+     4 bytes    crc32 of all of the above
+ */
+
+#include "gzguts.h"
+#include "zutil.h"
+
+#define IDX_SPAN 1048576UL  /* default distance between access points */
+#define IDX_WINSIZE 32768U  /* history needed to start inflating */
+#define IDX_CHUNK 65536U    /* input buffer size */
+#define IDX_HEAD 25         /* length of the index file header */
+#define IDX_POINT 23        /* length of an access point before its history */
+
+/* access point */
+typedef struct {
+    z_off64_t in;           /* offset in input of first full byte */
+    z_off64_t out;          /* corresponding offset in uncompressed data */
+    int bits;               /* number of bits (1-7) from byte at in - 1, or 0 */
+    unsigned wsize;         /* length of preceding history, up to 32K */
+    unsigned wlen;          /* length of compressed history */
+    unsigned char *window;  /* compressed history */
+} idx_point;
+
+/* access point list */
+struct gz_index_s {
+    unsigned have;          /* number of list entries filled in */
+    unsigned size;          /* number of list entries allocated */
+    z_off64_t length;       /* total length of the uncompressed data */
+    z_off64_t span;         /* span used when building the index */
+    idx_point *list;        /* allocated list */
+};
+typedef struct gz_index_s FAR *gz_indexp;
+
+/* Local functions */
+local int idx_full OF((int, unsigned char *, unsigned));
+local void idx_put OF((unsigned char *, z_off64_t, int));
+local z_off64_t idx_get OF((const unsigned char *, int));
+local int idx_pack OF((idx_point *, const unsigned char *, unsigned, unsigned,
+                       unsigned char *));
+local int idx_unpack OF((const idx_point *, unsigned char *));
+local int idx_add OF((gz_indexp, int, z_off64_t, z_off64_t, unsigned,
+                      const unsigned char *));
+
+/* Read exactly len bytes from fd into buf, or up to len bytes at the end of
+   the file.  Return the number of bytes read, or -1 on error. */
+local int idx_full(fd, buf, len)
+    int fd;
+    unsigned char *buf;
+    unsigned len;
+{
+    int got;
+    unsigned have = 0;
+
+    while (have < len) {
+        got = read(fd, buf + have, len - have);
+        if (got < 0)
+            return -1;
+        if (got == 0)
+            break;
+        have += (unsigned)got;
+    }
+    return (int)have;
+}
+
+/* Store the low n bytes of val in buf, little-endian. */
+local void idx_put(buf, val, n)
+    unsigned char *buf;
+    z_off64_t val;
+    int n;
+{
+    int k;
+
+    for (k = 0; k < n; k++) {
+        buf[k] = (unsigned char)val;
+        val >>= 8;
+    }
+}
+
+/* Return the little-endian n-byte value at buf. */
+local z_off64_t idx_get(buf, n)
+    const unsigned char *buf;
+    int n;
+{
+    z_off64_t val = 0;
+
+    while (n--)
+        val = (val << 8) + buf[n];
+    return val;
+}
+
+/* Compress the circular 32K window, whose oldest byte is at window[next],
+   keeping only the last have bytes, and save it in point.  Use work for the
+   linear copy.  Return Z_OK or Z_MEM_ERROR. */
+local int idx_pack(point, window, next, have, work)
+    idx_point *point;
+    const unsigned char *window;
+    unsigned next;
+    unsigned have;
+    unsigned char *work;
+{
+    int ret;
+    uLong bound;
+    z_stream strm;
+
+    /* straighten out the window, oldest byte first */
+    zmemcpy(work, window + next, IDX_WINSIZE - next);
+    if (next)
+        zmemcpy(work + IDX_WINSIZE - next, window, next);
+    point->wsize = have;
+    point->wlen = 0;
+    point->window = NULL;
+    if (have == 0)
+        return Z_OK;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    ret = deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+                       MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK)
+        return ret;
+    bound = deflateBound(&strm, have);
+    point->window = (unsigned char *)malloc(bound);
+    if (point->window == NULL) {
+        (void)deflateEnd(&strm);
+        return Z_MEM_ERROR;
+    }
+    strm.next_in = work + IDX_WINSIZE - have;
+    strm.avail_in = have;
+    strm.next_out = point->window;
+    strm.avail_out = (uInt)bound;
+    ret = deflate(&strm, Z_FINISH);
+    point->wlen = (unsigned)(bound - strm.avail_out);
+    (void)deflateEnd(&strm);
+    if (ret != Z_STREAM_END) {
+        free(point->window);
+        point->window = NULL;
+        return Z_MEM_ERROR;
+    }
+    return Z_OK;
+}
+
+/* Decompress the history of point into window.  Return Z_OK, Z_MEM_ERROR,
+   or Z_DATA_ERROR if the saved history is not valid. */
+local int idx_unpack(point, window)
+    const idx_point *point;
+    unsigned char *window;
+{
+    int ret;
+    z_stream strm;
+
+    if (point->wsize == 0)
+        return Z_OK;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = point->window;
+    strm.avail_in = point->wlen;
+    ret = inflateInit2(&strm, -MAX_WBITS);
+    if (ret != Z_OK)
+        return ret;
+    strm.next_out = window;
+    strm.avail_out = point->wsize;
+    ret = inflate(&strm, Z_FINISH);
+    (void)inflateEnd(&strm);
+    if (ret == Z_MEM_ERROR)
+        return ret;
+    return ret == Z_STREAM_END && strm.avail_out == 0 ? Z_OK : Z_DATA_ERROR;
+}
+
+/* Add an access point to the list, with the history taken from the circular
+   window, whose oldest byte is at window[next] -- the window is followed by
+   IDX_WINSIZE bytes of scratch space.  Return Z_OK or Z_MEM_ERROR. */
+local int idx_add(index, bits, in, out, next, window)
+    gz_indexp index;
+    int bits;
+    z_off64_t in;
+    z_off64_t out;
+    unsigned next;
+    const unsigned char *window;
+{
+    idx_point *list;
+
+    if (index->have == index->size) {
+        list = (idx_point *)realloc(index->list,
+                                    sizeof(idx_point) * (index->size << 1));
+        if (list == NULL)
+            return Z_MEM_ERROR;
+        index->list = list;
+        index->size <<= 1;
+    }
+    list = index->list + index->have;
+    list->bits = bits;
+    list->in = in;
+    list->out = out;
+    if (idx_pack(list, window, next,
+                 out < IDX_WINSIZE ? (unsigned)out : IDX_WINSIZE,
+                 (unsigned char *)window + IDX_WINSIZE) != Z_OK)
+        return Z_MEM_ERROR;
+    index->have++;
+    return Z_OK;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzindex_build(fd, span, built)
+    int fd;
+    unsigned long span;
+    gzIndex *built;
+{
+    int ret;
+    z_off64_t start, totin, totout, last;
+    unsigned char *input, *window;
+    gz_indexp index;
+    z_stream strm;
+
+    if (built == NULL)
+        return Z_STREAM_ERROR;
+    *built = NULL;
+    if (span == 0)
+        span = IDX_SPAN;
+    start = LSEEK(fd, 0, SEEK_CUR);
+    if (start == -1)
+        start = 0;
+
+    /* allocate the index, an input buffer, and the window with scratch */
+    index = (gz_indexp)malloc(sizeof(struct gz_index_s));
+    input = (unsigned char *)malloc(IDX_CHUNK);
+    window = (unsigned char *)malloc(IDX_WINSIZE << 1);
+    if (index != NULL) {
+        index->have = 0;
+        index->size = 8;
+        index->span = (z_off64_t)span;
+        index->list = (idx_point *)malloc(sizeof(idx_point) << 3);
+    }
+    if (index == NULL || index->list == NULL || input == NULL ||
+        window == NULL) {
+        if (index != NULL)
+            free(index->list);
+        free(index);
+        free(window);
+        free(input);
+        return Z_MEM_ERROR;
+    }
+
+    /* decompress the input with a sliding window, adding an access point at
+       the first block boundary after each span bytes of output -- this also
+       verifies the check value at the end of the stream */
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+    ret = inflateInit2(&strm, 47);      /* automatic zlib or gzip decoding */
+    totin = totout = last = 0;
+    strm.avail_out = 0;
+    while (ret == Z_OK) {
+        if (strm.avail_in == 0) {
+            ret = idx_full(fd, input, IDX_CHUNK);
+            if (ret <= 0) {
+                ret = ret ? Z_ERRNO : Z_BUF_ERROR;
+                break;
+            }
+            strm.avail_in = (unsigned)ret;
+            strm.next_in = input;
+        }
+        if (strm.avail_out == 0) {
+            strm.avail_out = IDX_WINSIZE;
+            strm.next_out = window;
+        }
+        totin += strm.avail_in;
+        totout += strm.avail_out;
+        ret = inflate(&strm, Z_BLOCK);
+        totin -= strm.avail_in;
+        totout -= strm.avail_out;
+        if (ret == Z_NEED_DICT)
+            ret = Z_DATA_ERROR;
+        if (ret == Z_BUF_ERROR)
+            ret = Z_OK;
+        if (ret != Z_OK)
+            break;
+
+        /* at the end of a block, but not the last one, consider adding an
+           access point -- totout == 0 puts the first one right after the
+           header */
+        if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+            (totout == 0 || totout - last >= (z_off64_t)span)) {
+            ret = idx_add(index, strm.data_type & 7, start + totin, totout,
+                          (IDX_WINSIZE - strm.avail_out) & (IDX_WINSIZE - 1),
+                          window);
+            last = totout;
+        }
+    }
+    (void)inflateEnd(&strm);
+    free(window);
+    free(input);
+    if (ret != Z_STREAM_END || index->have == 0) {
+        gzindex_free(index);
+        return ret == Z_STREAM_END ? Z_DATA_ERROR : ret;
+    }
+    index->length = totout;
+    *built = index;
+    return (int)index->have;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzindex_save(index, fd)
+    gzIndex index;
+    int fd;
+{
+    int got;
+    unsigned n, len;
+    uLong check;
+    unsigned char head[IDX_HEAD], *mem, *buf;
+    idx_point *point;
+
+    if (index == NULL)
+        return Z_STREAM_ERROR;
+    zmemcpy(head, "GZIX", 4);
+    head[4] = 1;
+    idx_put(head + 5, index->have, 4);
+    idx_put(head + 9, index->length, 8);
+    idx_put(head + 17, index->span, 8);
+    check = crc32(0L, head, IDX_HEAD);
+
+    /* write the header and then each point, as one buffer each */
+    mem = NULL;
+    buf = head;
+    len = IDX_HEAD;
+    for (n = 0; n <= index->have; n++) {
+        if (n) {
+            point = index->list + n - 1;
+            len = IDX_POINT + point->wlen;
+            mem = buf = (unsigned char *)malloc(len);
+            if (mem == NULL)
+                return Z_MEM_ERROR;
+            idx_put(buf, point->in, 8);
+            idx_put(buf + 8, point->out, 8);
+            buf[16] = (unsigned char)point->bits;
+            idx_put(buf + 17, point->wsize, 2);
+            idx_put(buf + 19, point->wlen, 4);
+            if (point->wlen)
+                zmemcpy(buf + IDX_POINT, point->window, point->wlen);
+            check = crc32(check, buf, len);
+        }
+        got = 1;
+        while (len && (got = write(fd, buf, len)) > 0) {
+            buf += got;
+            len -= (unsigned)got;
+        }
+        free(mem);
+        if (got <= 0)
+            return Z_ERRNO;
+    }
+    idx_put(head, check, 4);
+    return write(fd, head, 4) == 4 ? Z_OK : Z_ERRNO;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzindex_load(fd, loaded)
+    int fd;
+    gzIndex *loaded;
+{
+    int ret;
+    unsigned n;
+    uLong check;
+    unsigned char head[IDX_HEAD];
+    idx_point *point;
+    gz_indexp index;
+
+    if (loaded == NULL)
+        return Z_STREAM_ERROR;
+    *loaded = NULL;
+    ret = idx_full(fd, head, IDX_HEAD);
+    if (ret < 0)
+        return Z_ERRNO;
+    if (ret != IDX_HEAD || zmemcmp(head, "GZIX", 4) || head[4] != 1 ||
+        idx_get(head + 5, 4) == 0)
+        return Z_DATA_ERROR;
+    check = crc32(0L, head, IDX_HEAD);
+
+    index = (gz_indexp)malloc(sizeof(struct gz_index_s));
+    if (index == NULL)
+        return Z_MEM_ERROR;
+    index->size = (unsigned)idx_get(head + 5, 4);
+    index->have = 0;
+    index->length = idx_get(head + 9, 8);
+    index->span = idx_get(head + 17, 8);
+    index->list = (idx_point *)malloc(sizeof(idx_point) * index->size);
+    if (index->list == NULL) {
+        free(index);
+        return Z_MEM_ERROR;
+    }
+    ret = Z_OK;
+    while (ret == Z_OK && index->have < index->size) {
+        point = index->list + index->have;
+        n = (unsigned)idx_full(fd, head, IDX_POINT);
+        if (n != IDX_POINT) {
+            ret = n == (unsigned)-1 ? Z_ERRNO : Z_DATA_ERROR;
+            break;
+        }
+        check = crc32(check, head, IDX_POINT);
+        point->in = idx_get(head, 8);
+        point->out = idx_get(head + 8, 8);
+        point->bits = head[16];
+        point->wsize = (unsigned)idx_get(head + 17, 2);
+        point->wlen = (unsigned)idx_get(head + 19, 4);
+        if (point->bits > 7 || point->wsize > IDX_WINSIZE ||
+            point->wlen > (IDX_WINSIZE << 1) || (point->wsize == 0) !=
+            (point->wlen == 0)) {
+            ret = Z_DATA_ERROR;
+            break;
+        }
+        point->window = NULL;
+        if (point->wlen) {
+            point->window = (unsigned char *)malloc(point->wlen);
+            if (point->window == NULL) {
+                ret = Z_MEM_ERROR;
+                break;
+            }
+            if ((unsigned)idx_full(fd, point->window, point->wlen) !=
+                point->wlen) {
+                free(point->window);
+                ret = Z_DATA_ERROR;
+                break;
+            }
+            check = crc32(check, point->window, point->wlen);
+        }
+        index->have++;
+    }
+    if (ret == Z_OK && (idx_full(fd, head, 4) != 4 ||
+                        (uLong)idx_get(head, 4) != check))
+        ret = Z_DATA_ERROR;
+    if (ret != Z_OK) {
+        gzindex_free(index);
+        return ret;
+    }
+    *loaded = index;
+    return (int)index->have;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzindex_read64(index, fd, offset, buf, len)
+    gzIndex index;
+    int fd;
+    z_off64_t offset;
+    voidp buf;
+    unsigned len;
+{
+    int ret, skip;
+    unsigned lo, hi, mid;
+    unsigned char *input, *discard;
+    idx_point *here;
+    z_stream strm;
+
+    if (index == NULL || fd == -1)
+        return Z_STREAM_ERROR;
+
+    /* a negative offset counts back from the end, for reading the tail */
+    if (offset < 0) {
+        offset += index->length;
+        if (offset < 0)
+            offset = 0;
+    }
+    if ((int)len < 0)
+        len = INT_MAX;
+    if (len == 0 || offset >= index->length)
+        return 0;
+
+    /* find the last access point at or before offset */
+    lo = 0;
+    hi = index->have;
+    while (hi - lo > 1) {
+        mid = lo + ((hi - lo) >> 1);
+        if (index->list[mid].out <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    here = index->list + lo;
+
+    /* get the history and input buffers, and start inflate there */
+    input = (unsigned char *)malloc(IDX_CHUNK + IDX_WINSIZE);
+    if (input == NULL)
+        return Z_MEM_ERROR;
+    discard = input + IDX_CHUNK;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+    ret = inflateInit2(&strm, -MAX_WBITS);          /* raw inflate */
+    if (ret != Z_OK) {
+        free(input);
+        return ret;
+    }
+    ret = idx_unpack(here, discard);
+    if (ret == Z_OK && here->wsize)
+        ret = inflateSetDictionary(&strm, discard, here->wsize);
+    if (ret == Z_OK &&
+        LSEEK(fd, here->in - (here->bits ? 1 : 0), SEEK_SET) == -1)
+        ret = Z_ERRNO;
+    if (ret == Z_OK && here->bits) {
+        ret = idx_full(fd, input, 1);
+        if (ret == 1)
+            ret = inflatePrime(&strm, here->bits,
+                               input[0] >> (8 - here->bits));
+        else
+            ret = ret ? Z_ERRNO : Z_DATA_ERROR;
+    }
+
+    /* skip uncompressed bytes until offset reached, then satisfy request */
+    offset -= here->out;
+    skip = 1;
+    while (ret == Z_OK) {
+        if (offset == 0 && skip) {
+            strm.next_out = (Bytef *)buf;
+            strm.avail_out = len;
+            skip = 0;
+        }
+        if (offset > IDX_WINSIZE) {
+            strm.next_out = discard;
+            strm.avail_out = IDX_WINSIZE;
+            offset -= IDX_WINSIZE;
+        }
+        else if (offset != 0) {
+            strm.next_out = discard;
+            strm.avail_out = (unsigned)offset;
+            offset = 0;
+        }
+
+        /* decompress until avail_out filled, or end of stream */
+        do {
+            if (strm.avail_in == 0) {
+                ret = idx_full(fd, input, IDX_CHUNK);
+                if (ret <= 0) {
+                    ret = ret ? Z_ERRNO : Z_DATA_ERROR;
+                    break;
+                }
+                strm.avail_in = (unsigned)ret;
+                strm.next_in = input;
+            }
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret == Z_NEED_DICT)
+                ret = Z_DATA_ERROR;
+        } while (ret == Z_OK && strm.avail_out != 0);
+        if (ret != Z_OK || !skip)
+            break;
+    }
+    (void)inflateEnd(&strm);
+    free(input);
+    if (ret != Z_OK && ret != Z_STREAM_END)
+        return ret;
+    return skip ? 0 : (int)(len - strm.avail_out);
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzindex_read(index, fd, offset, buf, len)
+    gzIndex index;
+    int fd;
+    z_off_t offset;
+    voidp buf;
+    unsigned len;
+{
+    return gzindex_read64(index, fd, (z_off64_t)offset, buf, len);
+}
+
+/* -- see zlib.h -- */
+void ZEXPORT gzindex_free(index)
+    gzIndex index;
+{
+    unsigned n;
+
+    if (index == NULL)
+        return;
+    for (n = 0; n < index->have; n++)
+        free(index->list[n].window);
+    free(index->list);
+    free(index);
+}
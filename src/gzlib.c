@@ -5,16 +5,6 @@
 
 #include "gzguts.h"
 
-#if defined(_WIN32) && !defined(__BORLANDC__)
-#  define LSEEK _lseeki64
-#else
-#if defined(_LARGEFILE64_SOURCE) && _LFS64_LARGEFILE-0
-#  define LSEEK lseek64
-#else
-#  define LSEEK lseek
-#endif
-#endif
-
 /* Local functions */
 local void gz_reset OF((gz_statep));
 local gzFile gz_open OF((const void *, int, const char *));
@@ -80,6 +70,8 @@ local void gz_reset(state)
         state->eof = 0;             /* not at end of file */
         state->past = 0;            /* have not read past end yet */
         state->how = LOOK;          /* look for gzip header */
+        state->raw = 0;             /* start with the gzip header */
+        state->trail = 0;
     }
     state->seek = 0;                /* no seek request pending */
     gz_error(state, Z_OK, NULL);    /* clear error */
@@ -114,6 +106,14 @@ local gzFile gz_open(path, fd, mode)
     state->size = 0;            /* no buffers allocated yet */
     state->want = GZBUFSIZE;    /* requested buffer size */
     state->msg = NULL;          /* no error message yet */
+    state->span = 0;            /* no access points unless requested */
+    state->points = NULL;
+    state->npoints = 0;
+    state->maxpoints = 0;
+#ifdef GZ_MMAP
+    state->mapok = 0;           /* input is not mapped unless requested */
+    state->map = NULL;          /* if so, it is mapped when first read */
+#endif
 
     /* interpret mode */
     state->mode = GZ_NONE;
@@ -163,9 +163,20 @@ local gzFile gz_open(path, fd, mode)
             case 'F':
                 state->strategy = Z_FIXED;
                 break;
+            case 'Q':
+                state->strategy = Z_QUICK;
+                break;
+            case 'O':
+                state->strategy = Z_OPTIMAL;
+                break;
             case 'T':
                 state->direct = 1;
                 break;
+#ifdef GZ_MMAP
+            case 'm':
+                state->mapok = 1;
+                break;
+#endif
             default:        /* could consider as an error, but just ignore */
                 ;
             }
@@ -335,6 +346,25 @@ int ZEXPORT gzbuffer(file, size)
     return 0;
 }
 
+/* -- see zlib.h -- */
+int ZEXPORT gzspan(file, span)
+    gzFile file;
+    unsigned long span;
+{
+    gz_statep state;
+
+    /* get internal structure and check integrity */
+    if (file == NULL)
+        return -1;
+    state = (gz_statep)file;
+    if (state->mode != GZ_READ)
+        return -1;
+
+    /* record access points from here on, keeping any already recorded */
+    state->span = span;
+    return 0;
+}
+
 /* -- see zlib.h -- */
 int ZEXPORT gzrewind(file)
     gzFile file;
@@ -406,6 +436,18 @@ z_off64_t ZEXPORT gzseek64(file, offset, whence)
         return state->x.pos;
     }
 
+    /* if reading and there is an access point between here and the target,
+       or before the target when going backwards, start from there */
+    if (state->mode == GZ_READ && state->npoints) {
+        ret = state->x.pos;
+        switch (gz_jump(state, ret + offset)) {
+        case -1:
+            return -1;
+        case 1:
+            offset += ret - state->x.pos;
+        }
+    }
+
     /* calculate skip amount, rewinding if needed for back seek when reading */
     if (offset < 0) {
         if (state->mode != GZ_READ)         /* writing -- can't go backwards */
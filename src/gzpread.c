@@ -0,0 +1,602 @@
+/* gzpread.c -- zlib function for decompressing gzip files with multiple threads
+ * Copyright (C) 1995-2013 Jean-loup Gailly and Mark Adler
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+   Deflate data can only be decoded from the start, since any match may refer
+   to up to 32K of earlier output.  But after a Z_FULL_FLUSH nothing refers to
+   data before it, and the flush leaves the same byte-aligned empty stored
+   block, 00 00 ff ff, that inflateSync() looks for.  So the compressed data
+   is cut at those markers into segments, and the segments are decoded at the
+   same time by worker threads, each starting with no history.
+
+   The markers are only candidates: the pattern can occur by chance in
+   compressed data, and Z_SYNC_FLUSH leaves the same marker without resetting
+   the history.  So the segments are accepted strictly in order.  The first
+   segment starts at a real block boundary.  A segment that starts at a real
+   boundary and decodes without error produced the right output, since inflate
+   rejects any distance that reaches back before its start.  If it also ended
+   exactly at the next candidate at a byte-aligned block boundary, then that
+   candidate is a real boundary as well.  When a segment fails either test,
+   that part of the stream is decoded serially using the preceding 32K of
+   output as the dictionary, until a block boundary lands on a later candidate
+   and parallel results can be used again.  A stream with no usable markers
+   is therefore still decoded correctly, just not in parallel.
+
+   The check values of the segments are put together with crc32_combine() and
+   compared to the gzip trailer.
+ */
+
+#include "gzguts.h"
+#include "zutil.h"
+
+#ifndef NO_PTHREADS
+#  if defined(_WIN32) && !defined(__CYGWIN__)
+#    define NO_PTHREADS
+#  endif
+#endif
+
+#ifndef NO_PTHREADS
+
+#include <pthread.h>
+
+#define GZU_SEGMENT 262144UL    /* minimum compressed length of a segment */
+#define GZU_MAXTHREADS 64       /* cap on the number of worker threads */
+#define GZU_DICT 32768U         /* history needed to resume decoding */
+
+/* outcomes of decoding one segment */
+#define GZU_BAD 0       /* error, or did not end on the next candidate */
+#define GZU_CLEAN 1     /* ended at a byte-aligned block boundary */
+#define GZU_END 2       /* reached the end of the deflate stream */
+
+/* one segment of compressed data and its decompressed output */
+typedef struct gzu_job_s {
+    struct gzu_job_s *next; /* next job in the work queue */
+    const unsigned char *in;    /* compressed data */
+    unsigned long len;      /* length of compressed data */
+    int final;              /* true if the segment runs to the end of input */
+    unsigned char *out;     /* decompressed data */
+    unsigned long olen;     /* length of decompressed data */
+    uLong check;            /* crc32 of the decompressed data */
+    unsigned long used;     /* compressed bytes used, for GZU_END */
+    int result;             /* GZU_BAD, GZU_CLEAN, or GZU_END */
+    int err;                /* Z_MEM_ERROR if out of memory, else Z_OK */
+    int done;               /* true when the worker is finished with it */
+} gzu_job;
+
+/* parallel gzip decompression state */
+typedef struct {
+    int out;                /* file descriptor to write to */
+    int err;                /* first error encountered, or Z_OK */
+    unsigned char *hist;    /* last GZU_DICT bytes of output */
+    unsigned hlen;          /* number of bytes in hist */
+    uLong check;            /* crc32 of the output so far */
+    uLong total;            /* length of the output so far, modulo 2^32 */
+    int quit;               /* true to tell the workers to exit */
+    pthread_mutex_t lock;   /* protects everything below */
+    pthread_cond_t work;    /* signaled when a job is queued or quit set */
+    pthread_cond_t done;    /* signaled when a job is decoded */
+    gzu_job *head, *tail;   /* queue of jobs waiting for a worker */
+} gzu_state;
+
+/* Local functions */
+local int gzu_load OF((int, unsigned char **, unsigned long *));
+local unsigned long *gzu_scan OF((const unsigned char *, unsigned long,
+                                  unsigned long, unsigned long *));
+local void gzu_decode OF((z_streamp, gzu_job *));
+local void *gzu_worker OF((void *));
+local int gzu_put OF((gzu_state *, const unsigned char *, unsigned long));
+local long gzu_serial OF((gzu_state *, z_streamp, const unsigned char *,
+                          unsigned long, const unsigned long *,
+                          unsigned long, unsigned long, unsigned long *));
+
+/* Read all of fd into a new buffer.  Return Z_OK, Z_ERRNO, or Z_MEM_ERROR. */
+local int gzu_load(fd, buf, len)
+    int fd;
+    unsigned char **buf;
+    unsigned long *len;
+{
+    int got;
+    unsigned long size = 1UL << 20;
+    unsigned char *next;
+
+    *len = 0;
+    *buf = (unsigned char *)malloc(size);
+    if (*buf == NULL)
+        return Z_MEM_ERROR;
+    for (;;) {
+        if (*len == size) {
+            next = (unsigned char *)realloc(*buf, size << 1);
+            if (next == NULL || (size << 1) < size)
+                return Z_MEM_ERROR;
+            *buf = next;
+            size <<= 1;
+        }
+        got = read(fd, *buf + *len,
+                   size - *len > (1U << 30) ? 1U << 30 :
+                                              (unsigned)(size - *len));
+        if (got < 0)
+            return Z_ERRNO;
+        if (got == 0)
+            return Z_OK;
+        *len += (unsigned)got;
+    }
+}
+
+/* Find the candidate segment starts in buf[start..end-1], at least
+   GZU_SEGMENT bytes apart.  Return an allocated list that starts with start,
+   or NULL if out of memory.  *count is set to the number of entries. */
+local unsigned long *gzu_scan(buf, start, end, count)
+    const unsigned char *buf;
+    unsigned long start;
+    unsigned long end;
+    unsigned long *count;
+{
+    unsigned long n, size, pos, *list, *more;
+
+    size = 16;
+    list = (unsigned long *)malloc(size * sizeof(unsigned long));
+    if (list == NULL)
+        return NULL;
+    list[0] = start;
+    n = 1;
+    pos = start + GZU_SEGMENT;
+    while (pos + 4 <= end) {
+        if (buf[pos + 3] != 0xff)
+            pos += buf[pos + 3] ? 4 : 1;    /* no match ending at pos + 3 */
+        else if (buf[pos] || buf[pos + 1] || buf[pos + 2] != 0xff)
+            pos++;
+        else {
+            pos += 4;
+            if (pos == end)
+                break;
+            if (n == size) {
+                more = (unsigned long *)realloc(list,
+                                         (size << 1) * sizeof(unsigned long));
+                if (more == NULL) {
+                    free(list);
+                    return NULL;
+                }
+                list = more;
+                size <<= 1;
+            }
+            list[n++] = pos;
+            pos += GZU_SEGMENT;
+        }
+    }
+    *count = n;
+    return list;
+}
+
+/* Decode one segment with no history, limited to the segment's input. */
+local void gzu_decode(strm, job)
+    z_streamp strm;
+    gzu_job *job;
+{
+    int ret;
+    unsigned long size, have = job->len;
+    unsigned char *out;
+
+    job->result = GZU_BAD;
+    job->err = Z_OK;
+    job->olen = 0;
+    if (inflateReset(strm) != Z_OK)
+        return;
+    size = job->len < 16384 ? 65536UL : job->len << 2;
+    job->out = (unsigned char *)malloc(size);
+    if (job->out == NULL) {
+        job->err = Z_MEM_ERROR;
+        return;
+    }
+    strm->next_in = (z_const Bytef *)job->in;
+    strm->avail_in = 0;
+    strm->avail_out = 0;
+    for (;;) {
+        if (strm->avail_in == 0) {
+            strm->avail_in = have > UINT_MAX ? UINT_MAX : (uInt)have;
+            have -= strm->avail_in;
+        }
+        if (strm->avail_out == 0) {
+            if (job->olen == size) {
+                out = (unsigned char *)realloc(job->out, size << 1);
+                if (out == NULL || (size << 1) < size) {
+                    job->err = Z_MEM_ERROR;
+                    return;
+                }
+                job->out = out;
+                size <<= 1;
+            }
+            strm->next_out = job->out + job->olen;
+            strm->avail_out = size - job->olen > UINT_MAX ? UINT_MAX :
+                              (uInt)(size - job->olen);
+        }
+        ret = inflate(strm, Z_BLOCK);
+        job->olen = (unsigned long)(strm->next_out - job->out);
+        if (ret == Z_STREAM_END) {
+            job->used = job->len - have - strm->avail_in;
+            job->result = GZU_END;
+            break;
+        }
+        if (ret == Z_MEM_ERROR)
+            job->err = Z_MEM_ERROR;
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+            break;
+        if (strm->avail_in == 0 && have == 0 && strm->avail_out) {
+            /* all input used -- clean only if at a byte-aligned boundary */
+            if (!job->final && strm->data_type == 128)
+                job->result = GZU_CLEAN;
+            break;
+        }
+    }
+}
+
+/* Worker thread: take jobs off the queue and decode them until told to
+   quit.  Each worker has its own raw inflate stream. */
+local void *gzu_worker(arg)
+    void *arg;
+{
+    int init;
+    unsigned long left;
+    unsigned char *next;
+    gzu_job *job;
+    z_stream strm;
+    gzu_state *state = (gzu_state *)arg;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = Z_NULL;
+    strm.avail_in = 0;
+    init = inflateInit2(&strm, -MAX_WBITS);
+    for (;;) {
+        /* get the next job */
+        pthread_mutex_lock(&state->lock);
+        while (state->head == NULL && !state->quit)
+            pthread_cond_wait(&state->work, &state->lock);
+        job = state->head;
+        if (job == NULL) {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+        state->head = job->next;
+        if (state->head == NULL)
+            state->tail = NULL;
+        pthread_mutex_unlock(&state->lock);
+
+        /* decode it and compute the check value of the output */
+        if (init == Z_OK)
+            gzu_decode(&strm, job);
+        else {
+            job->result = GZU_BAD;
+            job->err = init;
+        }
+        job->check = crc32(0L, Z_NULL, 0);
+        if (job->result != GZU_BAD) {
+            next = job->out;
+            left = job->olen;
+            while (left > UINT_MAX) {
+                job->check = crc32(job->check, next, UINT_MAX);
+                next += UINT_MAX;
+                left -= UINT_MAX;
+            }
+            job->check = crc32(job->check, next, (uInt)left);
+        }
+
+        /* hand it back */
+        pthread_mutex_lock(&state->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&state->done);
+        pthread_mutex_unlock(&state->lock);
+    }
+    if (init == Z_OK)
+        (void)inflateEnd(&strm);
+    return NULL;
+}
+
+/* Write len bytes from buf to the output and keep the last GZU_DICT bytes
+   of the output in hist.  Return -1 on error, 0 on success. */
+local int gzu_put(state, buf, len)
+    gzu_state *state;
+    const unsigned char *buf;
+    unsigned long len;
+{
+    int got;
+    unsigned keep;
+    const unsigned char *next = buf;
+    unsigned long left = len;
+
+    while (left) {
+        got = write(state->out, next, left > (1U << 30) ? 1U << 30 :
+                                                         (unsigned)left);
+        if (got <= 0) {
+            state->err = Z_ERRNO;
+            return -1;
+        }
+        next += got;
+        left -= (unsigned)got;
+    }
+    state->total += len;
+
+    if (len >= GZU_DICT) {
+        zmemcpy(state->hist, buf + len - GZU_DICT, GZU_DICT);
+        state->hlen = GZU_DICT;
+    }
+    else {
+        keep = GZU_DICT - (unsigned)len;
+        if (keep > state->hlen)
+            keep = state->hlen;
+        memmove(state->hist, state->hist + state->hlen - keep, keep);
+        zmemcpy(state->hist + keep, buf, (unsigned)len);
+        state->hlen = keep + (unsigned)len;
+    }
+    return 0;
+}
+
+/* Decode serially from list[k], the start of a segment that could not be
+   decoded on its own, using the output so far as history.  Stop when a
+   byte-aligned block boundary lands on a later candidate, and return its
+   index, or at the end of the deflate stream, and return count with *trail
+   set to the offset of the gzip trailer.  Return -1 on error. */
+local long gzu_serial(state, strm, buf, len, list, count, k, trail)
+    gzu_state *state;
+    z_streamp strm;
+    const unsigned char *buf;
+    unsigned long len;
+    const unsigned long *list;
+    unsigned long count;
+    unsigned long k;
+    unsigned long *trail;
+{
+    int ret;
+    unsigned n;
+    unsigned long pos, have, j = k + 1;
+    unsigned char out[GZU_DICT];
+
+    ret = inflateReset(strm);
+    if (ret == Z_OK && state->hlen)
+        ret = inflateSetDictionary(strm, state->hist, state->hlen);
+    if (ret != Z_OK) {
+        state->err = ret;
+        return -1;
+    }
+    strm->next_in = (z_const Bytef *)buf + list[k];
+    strm->avail_in = 0;
+    have = len - list[k];
+    for (;;) {
+        if (strm->avail_in == 0) {
+            strm->avail_in = have > UINT_MAX ? UINT_MAX : (uInt)have;
+            have -= strm->avail_in;
+        }
+        strm->next_out = out;
+        strm->avail_out = sizeof(out);
+        ret = inflate(strm, Z_BLOCK);
+        n = sizeof(out) - strm->avail_out;
+        if (n) {
+            state->check = crc32(state->check, out, n);
+            if (gzu_put(state, out, n))
+                return -1;
+        }
+        pos = (unsigned long)(strm->next_in - buf);
+        if (ret == Z_STREAM_END) {
+            *trail = pos;
+            return (long)count;
+        }
+        if (ret == Z_BUF_ERROR && strm->avail_in == 0 && have == 0) {
+            state->err = Z_BUF_ERROR;       /* input ended early */
+            return -1;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            state->err = ret == Z_MEM_ERROR ? Z_MEM_ERROR : Z_DATA_ERROR;
+            return -1;
+        }
+        if (strm->data_type == 128) {
+            while (j < count && list[j] < pos)
+                j++;
+            if (j < count && list[j] == pos)
+                return (long)j;
+        }
+    }
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzpuncompress(in, out, threads)
+    int in;
+    int out;
+    int threads;
+{
+    int ret, n, running;
+    long next;
+    unsigned long len, count, k, ahead, sub, trail, i;
+    unsigned char *buf, byte;
+    unsigned long *list;
+    gzu_job *jobs, *job;
+    pthread_t tid[GZU_MAXTHREADS];
+    gzu_state state;
+    z_stream strm;
+
+    if (in == -1 || out == -1)
+        return Z_STREAM_ERROR;
+    if (threads < 1)
+        threads = 1;
+    if (threads > GZU_MAXTHREADS)
+        threads = GZU_MAXTHREADS;
+
+    /* get the compressed data and find the start of the deflate stream */
+    ret = gzu_load(in, &buf, &len);
+    if (ret != Z_OK) {
+        free(buf);
+        return ret;
+    }
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = buf;
+    strm.avail_in = len > UINT_MAX ? UINT_MAX : (uInt)len;
+    ret = inflateInit2(&strm, MAX_WBITS + 16);
+    if (ret != Z_OK) {
+        free(buf);
+        return ret;
+    }
+    strm.next_out = &byte;
+    strm.avail_out = 1;
+    ret = inflate(&strm, Z_BLOCK);
+    if (ret == Z_OK && strm.data_type != 128)
+        ret = Z_DATA_ERROR;
+    if (ret != Z_OK) {
+        (void)inflateEnd(&strm);
+        free(buf);
+        return ret == Z_BUF_ERROR || ret == Z_MEM_ERROR ? ret : Z_DATA_ERROR;
+    }
+    trail = (unsigned long)(strm.next_in - buf);
+    (void)inflateEnd(&strm);
+
+    /* plan the segments -- no candidates in the trailer */
+    list = gzu_scan(buf, trail, len - trail > 8 ? len - 8 : trail, &count);
+    jobs = list == NULL ? NULL :
+                          (gzu_job *)calloc((size_t)count, sizeof(gzu_job));
+    ret = jobs == NULL ? Z_MEM_ERROR : inflateInit2(&strm, -MAX_WBITS);
+    if (ret != Z_OK) {
+        free(jobs);
+        free(list);
+        free(buf);
+        return ret;
+    }
+    for (k = 0; k < count; k++) {
+        jobs[k].in = buf + list[k];
+        jobs[k].len = (k + 1 < count ? list[k + 1] : len) - list[k];
+        jobs[k].final = k + 1 == count;
+    }
+
+    /* start the workers */
+    zmemzero(&state, sizeof(state));
+    state.out = out;
+    state.err = Z_OK;
+    state.check = crc32(0L, Z_NULL, 0);
+    state.hist = (unsigned char *)malloc(GZU_DICT);
+    if (state.hist == NULL)
+        state.err = Z_MEM_ERROR;
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.work, NULL);
+    pthread_cond_init(&state.done, NULL);
+    if ((unsigned long)threads > count)
+        threads = (int)count;
+    running = 0;
+    while (state.err == Z_OK && running < threads &&
+           pthread_create(tid + running, NULL, gzu_worker, &state) == 0)
+        running++;
+    if (running == 0 && state.err == Z_OK)
+        state.err = Z_MEM_ERROR;
+
+    /* accept the segments in order, keeping up to twice as many segments as
+       threads in progress */
+    ahead = 2 * (unsigned long)threads;
+    sub = 0;
+    k = 0;
+    trail = 0;
+    while (state.err == Z_OK && k < count) {
+        pthread_mutex_lock(&state.lock);
+        for (; sub < count && sub < k + ahead; sub++) {
+            job = jobs + sub;
+            if (state.tail == NULL)
+                state.head = job;
+            else
+                state.tail->next = job;
+            state.tail = job;
+            pthread_cond_signal(&state.work);
+        }
+        job = jobs + k;
+        while (!job->done)
+            pthread_cond_wait(&state.done, &state.lock);
+        pthread_mutex_unlock(&state.lock);
+
+        if (job->err != Z_OK) {
+            state.err = job->err;
+            break;
+        }
+        if (job->result != GZU_BAD) {
+            /* decoded on its own -- use it */
+            if (gzu_put(&state, job->out, job->olen))
+                break;
+            state.check = crc32_combine(state.check, job->check,
+                                        (z_off_t)job->olen);
+            free(job->out);
+            job->out = NULL;
+            if (job->result == GZU_END) {
+                trail = list[k] + job->used;
+                break;
+            }
+            k++;
+            continue;
+        }
+
+        /* decode serially up to the next usable segment and discard the
+           parallel results that were passed over */
+        next = gzu_serial(&state, &strm, buf, len, list, count, k, &trail);
+        if (next < 0)
+            break;
+        for (i = k; i < (unsigned long)next && i < sub; i++) {
+            pthread_mutex_lock(&state.lock);
+            while (!jobs[i].done)
+                pthread_cond_wait(&state.done, &state.lock);
+            pthread_mutex_unlock(&state.lock);
+            free(jobs[i].out);
+            jobs[i].out = NULL;
+        }
+        k = (unsigned long)next;
+        if (sub < k)
+            sub = k;        /* do not queue segments already decoded */
+    }
+
+    /* stop the workers, dropping any jobs not yet started */
+    pthread_mutex_lock(&state.lock);
+    state.head = state.tail = NULL;
+    state.quit = 1;
+    pthread_cond_broadcast(&state.work);
+    pthread_mutex_unlock(&state.lock);
+    while (running)
+        pthread_join(tid[--running], NULL);
+
+    /* check the trailer */
+    ret = state.err;
+    if (ret == Z_OK && trail == 0)
+        ret = Z_DATA_ERROR;
+    if (ret == Z_OK && len - trail < 8)
+        ret = Z_BUF_ERROR;
+    if (ret == Z_OK) {
+        for (n = 0; n < 4; n++)
+            if (buf[trail + n] != (unsigned char)(state.check >> (n << 3)) ||
+                buf[trail + 4 + n] != (unsigned char)(state.total >> (n << 3)))
+                ret = Z_DATA_ERROR;
+    }
+
+    /* clean up */
+    for (k = 0; k < count; k++)
+        free(jobs[k].out);
+    (void)inflateEnd(&strm);
+    pthread_cond_destroy(&state.done);
+    pthread_cond_destroy(&state.work);
+    pthread_mutex_destroy(&state.lock);
+    free(state.hist);
+    free(jobs);
+    free(list);
+    free(buf);
+    return ret;
+}
+
+#else /* NO_PTHREADS */
+
+/* no threads available -- gzpuncompress() always fails */
+
+int ZEXPORT gzpuncompress(in, out, threads)
+    int in;
+    int out;
+    int threads;
+{
+    (void)in;
+    (void)out;
+    (void)threads;
+    return Z_STREAM_ERROR;
+}
+
+#endif /* NO_PTHREADS */
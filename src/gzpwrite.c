@@ -0,0 +1,558 @@
+/* gzpwrite.c -- zlib functions for writing gzip files with multiple threads
+ * Copyright (C) 1995-2013 Jean-loup Gailly and Mark Adler
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+   The input is cut into blocks of a fixed size, and each block is compressed
+   as raw deflate data by one of a set of worker threads.  Each block is primed
+   with the last 32K of the block before it using deflateSetDictionary(), so
+   the compression ratio is very nearly that of a single-threaded deflate, and
+   each block ends with a Z_SYNC_FLUSH so that it ends on a byte boundary and
+   can simply be concatenated with the next one.  The last block ends with
+   Z_FINISH.  The check values of the blocks are computed in the workers and
+   put together in order with crc32_combine().  The result is a single
+   ordinary gzip member that any gzip decoder can read.
+
+   The caller's thread collects the compressed blocks in order and writes
+   them.  No more than count blocks are in progress at once, which bounds the
+   memory used to about count * (2 * size + 32K) bytes.
+ */
+
+#include "gzguts.h"
+#include "zutil.h"
+
+#ifndef NO_GZPWRITE
+#  if defined(NO_GZCOMPRESS) || defined(NO_PTHREADS) || \
+      (defined(_WIN32) && !defined(__CYGWIN__))
+#    define NO_GZPWRITE
+#  endif
+#endif
+
+#ifndef NO_GZPWRITE
+
+#include <pthread.h>
+
+#define GZP_DICT 32768U     /* amount of history carried between blocks */
+#define GZP_SIZE 131072U    /* default block size */
+#define GZP_MAXTHREADS 64   /* cap on the number of worker threads */
+
+/* one block of input and its compressed output */
+typedef struct gzp_job_s {
+    struct gzp_job_s *next; /* next job in the work queue */
+    struct gzp_job_s *seq;  /* next job in output order */
+    int last;               /* true if this is the final block */
+    unsigned char *in;      /* input data */
+    unsigned len;           /* length of input data */
+    unsigned char *dict;    /* preceding history, NULL for the first block */
+    unsigned dlen;          /* length of history */
+    unsigned char *out;     /* compressed data */
+    unsigned olen;          /* length of compressed data */
+    uLong check;            /* crc32 of the input data */
+    int err;                /* Z_OK or error from the worker */
+    int done;               /* true when out and check are ready */
+} gzp_job;
+
+/* parallel gzip writing state */
+struct gzp_state {
+    int fd;                 /* file descriptor to write to */
+    int level;              /* compression level */
+    int threads;            /* number of worker threads */
+    unsigned size;          /* input block size */
+    unsigned count;         /* maximum number of blocks in progress */
+    unsigned char *buf;     /* input being accumulated for the next block */
+    unsigned have;          /* number of bytes in buf */
+    unsigned char *hist;    /* last GZP_DICT bytes of the previous block */
+    unsigned hlen;          /* number of bytes in hist */
+    uLong check;            /* crc32 of all retired blocks */
+    uLong isize;            /* total uncompressed length, modulo 2^32 */
+    int err;                /* first error encountered, or Z_OK */
+    int started;            /* true once the threads and header are going */
+    unsigned inflight;      /* number of blocks submitted and not retired */
+    pthread_t *tid;         /* worker threads */
+    int running;            /* number of worker threads started */
+    int quit;               /* true to tell the workers to exit */
+    pthread_mutex_t lock;   /* protects everything below */
+    pthread_cond_t work;    /* signaled when a job is queued or quit set */
+    pthread_cond_t done;    /* signaled when a job is compressed */
+    gzp_job *head, *tail;   /* queue of jobs waiting for a worker */
+    gzp_job *first, *last;  /* all jobs in progress, in output order */
+};
+typedef struct gzp_state FAR *gzp_statep;
+
+/* Local functions */
+local int gzp_put OF((gzp_statep, const unsigned char *, unsigned));
+local void gzp_free OF((gzp_job *));
+local void *gzp_worker OF((void *));
+local int gzp_start OF((gzp_statep));
+local int gzp_retire OF((gzp_statep, unsigned));
+local int gzp_submit OF((gzp_statep, int));
+
+/* Write len bytes from buf to the output.  Return -1 on error, 0 on
+   success. */
+local int gzp_put(state, buf, len)
+    gzp_statep state;
+    const unsigned char *buf;
+    unsigned len;
+{
+    int got;
+
+    while (len) {
+        got = write(state->fd, buf, len);
+        if (got <= 0) {
+            state->err = Z_ERRNO;
+            return -1;
+        }
+        buf += got;
+        len -= (unsigned)got;
+    }
+    return 0;
+}
+
+/* Free a job and its buffers. */
+local void gzp_free(job)
+    gzp_job *job;
+{
+    free(job->out);
+    free(job->dict);
+    free(job->in);
+    free(job);
+}
+
+/* Worker thread: take jobs off the queue and compress them until told to
+   quit.  Each worker has its own deflate stream, reset for every block. */
+local void *gzp_worker(arg)
+    void *arg;
+{
+    int ret, init;
+    unsigned size;
+    unsigned char *out;
+    gzp_job *job;
+    z_stream strm;
+    gzp_statep state = (gzp_statep)arg;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    init = deflateInit2(&strm, state->level, Z_DEFLATED, -MAX_WBITS,
+                        DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    for (;;) {
+        /* get the next job */
+        pthread_mutex_lock(&state->lock);
+        while (state->head == NULL && !state->quit)
+            pthread_cond_wait(&state->work, &state->lock);
+        job = state->head;
+        if (job == NULL) {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+        state->head = job->next;
+        if (state->head == NULL)
+            state->tail = NULL;
+        pthread_mutex_unlock(&state->lock);
+
+        /* compress the block, growing the output buffer as needed -- the
+           initial size covers all but pathological cases */
+        ret = init;
+        if (ret == Z_OK) {
+            ret = deflateReset(&strm);
+            if (ret == Z_OK && job->dlen)
+                ret = deflateSetDictionary(&strm, job->dict, job->dlen);
+        }
+        if (ret == Z_OK) {
+            size = (unsigned)deflateBound(&strm, job->len) + 16;
+            job->out = (unsigned char *)malloc(size);
+            if (job->out == NULL)
+                ret = Z_MEM_ERROR;
+            strm.next_in = job->in;
+            strm.avail_in = job->len;
+            job->olen = 0;
+        }
+        while (ret == Z_OK) {
+            strm.next_out = job->out + job->olen;
+            strm.avail_out = size - job->olen;
+            ret = deflate(&strm, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+            job->olen = size - strm.avail_out;
+            if (ret == Z_BUF_ERROR)     /* flush was already complete */
+                ret = Z_OK;
+            if (ret != Z_OK || strm.avail_out)
+                break;
+            out = (unsigned char *)realloc(job->out, size << 1);
+            if (out == NULL || (size << 1) < size) {
+                ret = Z_MEM_ERROR;
+                break;
+            }
+            job->out = out;
+            size <<= 1;
+        }
+        job->err = ret == Z_STREAM_END ? Z_OK : ret;
+        job->check = crc32(0L, job->in, job->len);
+
+        /* the input and history are no longer needed */
+        free(job->in);
+        job->in = NULL;
+        free(job->dict);
+        job->dict = NULL;
+
+        /* hand it back */
+        pthread_mutex_lock(&state->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&state->done);
+        pthread_mutex_unlock(&state->lock);
+    }
+    if (init == Z_OK)
+        (void)deflateEnd(&strm);
+    return NULL;
+}
+
+/* Allocate the input buffers, start the worker threads, and write the gzip
+   header.  Return -1 on error, 0 on success. */
+local int gzp_start(state)
+    gzp_statep state;
+{
+    unsigned char head[10];
+
+    state->started = 1;
+    state->buf = (unsigned char *)malloc(state->size);
+    state->hist = (unsigned char *)malloc(GZP_DICT);
+    state->tid = (pthread_t *)malloc(state->threads * sizeof(pthread_t));
+    if (state->buf == NULL || state->hist == NULL || state->tid == NULL) {
+        state->err = Z_MEM_ERROR;
+        return -1;
+    }
+    while (state->running < state->threads) {
+        if (pthread_create(state->tid + state->running, NULL, gzp_worker,
+                           state))
+            break;
+        state->running++;
+    }
+    if (state->running == 0) {
+        state->err = Z_MEM_ERROR;
+        return -1;
+    }
+
+    /* gzip header: no name, no time stamp */
+    head[0] = 0x1f;
+    head[1] = 0x8b;
+    head[2] = Z_DEFLATED;
+    head[3] = 0;
+    head[4] = head[5] = head[6] = head[7] = 0;
+    head[8] = state->level == 9 ? 2 : (state->level == 1 ? 4 : 0);
+    head[9] = OS_CODE;
+    return gzp_put(state, head, 10);
+}
+
+/* Write out completed blocks in order.  Wait for blocks to complete until
+   there are no more than keep blocks still in progress.  Return -1 on error,
+   0 on success. */
+local int gzp_retire(state, keep)
+    gzp_statep state;
+    unsigned keep;
+{
+    gzp_job *job;
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        job = state->first;
+        if (job != NULL && !job->done && state->inflight > keep)
+            do {
+                pthread_cond_wait(&state->done, &state->lock);
+            } while (!job->done);
+        if (job == NULL || !job->done) {
+            pthread_mutex_unlock(&state->lock);
+            return state->err == Z_OK ? 0 : -1;
+        }
+        state->first = job->seq;
+        if (state->first == NULL)
+            state->last = NULL;
+        state->inflight--;
+        pthread_mutex_unlock(&state->lock);
+
+        /* write the block and fold its check value into the total */
+        if (state->err == Z_OK) {
+            if (job->err != Z_OK)
+                state->err = job->err;
+            else if (gzp_put(state, job->out, job->olen) == 0)
+                state->check = crc32_combine(state->check, job->check,
+                                             (z_off_t)job->len);
+        }
+        gzp_free(job);
+    }
+}
+
+/* Hand the accumulated input off to the workers as the next block, with last
+   true if it is the final one.  Return -1 on error, 0 on success. */
+local int gzp_submit(state, last)
+    gzp_statep state;
+    int last;
+{
+    unsigned keep;
+    gzp_job *job;
+
+    /* make room if the maximum number of blocks are in progress */
+    if (gzp_retire(state, state->count - 1))
+        return -1;
+
+    /* build the job, giving it the input buffer and a copy of the history */
+    job = (gzp_job *)malloc(sizeof(gzp_job));
+    if (job == NULL) {
+        state->err = Z_MEM_ERROR;
+        return -1;
+    }
+    job->next = job->seq = NULL;
+    job->last = last;
+    job->in = state->buf;
+    job->len = state->have;
+    job->dict = NULL;
+    job->dlen = state->hlen;
+    job->out = NULL;
+    job->olen = 0;
+    job->err = Z_OK;
+    job->done = 0;
+    state->buf = NULL;
+    if (job->dlen) {
+        job->dict = (unsigned char *)malloc(job->dlen);
+        if (job->dict == NULL) {
+            gzp_free(job);
+            state->err = Z_MEM_ERROR;
+            return -1;
+        }
+        zmemcpy(job->dict, state->hist, job->dlen);
+    }
+
+    /* save the end of this block as the history for the next one */
+    if (!last) {
+        keep = job->len < GZP_DICT ? job->len : GZP_DICT;
+        if (keep < GZP_DICT && state->hlen) {
+            /* short block: slide older history down to fill in */
+            if (state->hlen > GZP_DICT - keep)
+                state->hlen = GZP_DICT - keep;
+            memmove(state->hist, state->hist + (job->dlen - state->hlen),
+                    state->hlen);
+        }
+        else
+            state->hlen = 0;
+        zmemcpy(state->hist + state->hlen, job->in + job->len - keep, keep);
+        state->hlen += keep;
+        state->buf = (unsigned char *)malloc(state->size);
+        if (state->buf == NULL)
+            state->err = Z_MEM_ERROR;
+    }
+    state->have = 0;
+    state->isize += job->len;
+
+    /* queue it for the workers and in output order */
+    pthread_mutex_lock(&state->lock);
+    if (state->tail == NULL)
+        state->head = job;
+    else
+        state->tail->next = job;
+    state->tail = job;
+    if (state->last == NULL)
+        state->first = job;
+    else
+        state->last->seq = job;
+    state->last = job;
+    state->inflight++;
+    pthread_cond_signal(&state->work);
+    pthread_mutex_unlock(&state->lock);
+    return state->err == Z_OK ? 0 : -1;
+}
+
+/* -- see zlib.h -- */
+gzpFile ZEXPORT gzpdopen(fd, level, threads)
+    int fd;
+    int level;
+    int threads;
+{
+    gzp_statep state;
+
+    if (fd == -1 || level < Z_DEFAULT_COMPRESSION || level > 9)
+        return NULL;
+    if (level == Z_DEFAULT_COMPRESSION)
+        level = 6;
+    if (threads < 1)
+        threads = 1;
+    if (threads > GZP_MAXTHREADS)
+        threads = GZP_MAXTHREADS;
+
+    state = (gzp_statep)malloc(sizeof(struct gzp_state));
+    if (state == NULL)
+        return NULL;
+    zmemzero(state, sizeof(struct gzp_state));
+    if (pthread_mutex_init(&state->lock, NULL)) {
+        free(state);
+        return NULL;
+    }
+    if (pthread_cond_init(&state->work, NULL)) {
+        pthread_mutex_destroy(&state->lock);
+        free(state);
+        return NULL;
+    }
+    if (pthread_cond_init(&state->done, NULL)) {
+        pthread_cond_destroy(&state->work);
+        pthread_mutex_destroy(&state->lock);
+        free(state);
+        return NULL;
+    }
+    state->fd = fd;
+    state->level = level;
+    state->threads = threads;
+    state->size = GZP_SIZE;
+    state->count = 2 * (unsigned)threads;
+    state->check = crc32(0L, Z_NULL, 0);
+    state->err = Z_OK;
+    return (gzpFile)state;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzpbuffer(file, size, count)
+    gzpFile file;
+    unsigned size;
+    unsigned count;
+{
+    gzp_statep state;
+
+    if (file == NULL)
+        return -1;
+    state = (gzp_statep)file;
+    if (state->started || size == 0 || count == 0)
+        return -1;
+    state->size = size;
+    state->count = count;
+    return 0;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzpwrite(file, buf, len)
+    gzpFile file;
+    voidpc buf;
+    unsigned len;
+{
+    unsigned n, put = len;
+    const unsigned char *next = (const unsigned char *)buf;
+    gzp_statep state;
+
+    if (file == NULL)
+        return 0;
+    state = (gzp_statep)file;
+    if (state->err != Z_OK)
+        return 0;
+
+    /* since an int is returned, make sure len fits in one */
+    if ((int)len < 0)
+        return 0;
+    if (!state->started && gzp_start(state))
+        return 0;
+
+    /* fill blocks, handing each one off when full */
+    while (len) {
+        n = state->size - state->have;
+        if (n > len)
+            n = len;
+        zmemcpy(state->buf + state->have, next, n);
+        state->have += n;
+        next += n;
+        len -= n;
+        if (state->have == state->size && gzp_submit(state, 0))
+            return 0;
+    }
+
+    /* write whatever happens to be ready without waiting */
+    if (gzp_retire(state, state->inflight))
+        return 0;
+    return (int)put;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzpclose(file)
+    gzpFile file;
+{
+    int i, ret;
+    unsigned char trail[8];
+    gzp_statep state;
+
+    if (file == NULL)
+        return Z_STREAM_ERROR;
+    state = (gzp_statep)file;
+
+    /* compress the last block, write everything out, then the trailer */
+    if (state->err == Z_OK && (state->started || gzp_start(state) == 0) &&
+        gzp_submit(state, 1) == 0 && gzp_retire(state, 0) == 0) {
+        for (i = 0; i < 4; i++)
+            trail[i] = (unsigned char)(state->check >> (i << 3));
+        for (i = 0; i < 4; i++)
+            trail[i + 4] = (unsigned char)(state->isize >> (i << 3));
+        gzp_put(state, trail, 8);
+    }
+
+    /* stop the workers and discard anything left over after an error */
+    pthread_mutex_lock(&state->lock);
+    state->quit = 1;
+    pthread_cond_broadcast(&state->work);
+    pthread_mutex_unlock(&state->lock);
+    while (state->running)
+        pthread_join(state->tid[--state->running], NULL);
+    while (state->first != NULL) {
+        state->last = state->first->seq;
+        gzp_free(state->first);
+        state->first = state->last;
+    }
+    ret = state->err;
+    if (close(state->fd) == -1 && ret == Z_OK)
+        ret = Z_ERRNO;
+    pthread_cond_destroy(&state->done);
+    pthread_cond_destroy(&state->work);
+    pthread_mutex_destroy(&state->lock);
+    free(state->tid);
+    free(state->hist);
+    free(state->buf);
+    free(state);
+    return ret;
+}
+
+#else /* NO_GZPWRITE */
+
+/* no threads available -- gzpdopen() always fails */
+
+gzpFile ZEXPORT gzpdopen(fd, level, threads)
+    int fd;
+    int level;
+    int threads;
+{
+    (void)fd;
+    (void)level;
+    (void)threads;
+    return NULL;
+}
+
+int ZEXPORT gzpbuffer(file, size, count)
+    gzpFile file;
+    unsigned size;
+    unsigned count;
+{
+    (void)file;
+    (void)size;
+    (void)count;
+    return -1;
+}
+
+int ZEXPORT gzpwrite(file, buf, len)
+    gzpFile file;
+    voidpc buf;
+    unsigned len;
+{
+    (void)file;
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+int ZEXPORT gzpclose(file)
+    gzpFile file;
+{
+    (void)file;
+    return Z_STREAM_ERROR;
+}
+
+#endif /* NO_GZPWRITE */
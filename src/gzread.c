@@ -6,13 +6,43 @@
 #include "gzguts.h"
 
 /* Local functions */
+#ifdef GZ_MMAP
+local void gz_map OF((gz_statep));
+#endif
 local int gz_load OF((gz_statep, unsigned char *, unsigned, unsigned *));
 local int gz_avail OF((gz_statep));
 local int gz_look OF((gz_statep));
+local void gz_mark OF((gz_statep, z_off64_t));
 local int gz_decomp OF((gz_statep));
 local int gz_fetch OF((gz_statep));
 local int gz_skip OF((gz_statep, z_off64_t));
 
+#ifdef GZ_MMAP
+/* Map the input file in memory if it is a regular file larger than the input
+   buffer, so that gz_avail() can inflate directly from the mapping instead of
+   copying through state->in.  This is only done when 'm' was in the mode given
+   to gzopen().  The file descriptor position is kept in step with the input
+   used, so that LSEEK() still tells where the input is.  If the file can't be
+   mapped, input is read as usual. */
+local void gz_map(state)
+    gz_statep state;
+{
+    struct stat st;
+    void *map;
+
+    if (fstat(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+            st.st_size <= (off_t)state->want ||
+            (off_t)(size_t)st.st_size != st.st_size)
+        return;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, state->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    state->map = (unsigned char *)map;
+    state->maplen = st.st_size;
+}
+#endif
+
 /* Use read() to load a buffer -- return -1 on error, otherwise 0.  Read from
    state->fd, and update state->eof, state->err, and state->msg as appropriate.
    This function needs to loop on read(), since read() is not guaranteed to
@@ -57,6 +87,27 @@ local int gz_avail(state)
     if (state->err != Z_OK && state->err != Z_BUF_ERROR)
         return -1;
     if (state->eof == 0) {
+#ifdef GZ_MMAP
+        if (state->map != NULL) {   /* extend the input in the mapping */
+            z_off64_t pos = LSEEK(state->fd, 0, SEEK_CUR);
+            unsigned max = UINT_MAX - strm->avail_in;
+
+            if (pos != -1 && pos < state->maplen) {
+                if (strm->avail_in == 0)
+                    strm->next_in = state->map + pos;
+                if (strm->next_in + strm->avail_in == state->map + pos) {
+                    if (state->maplen - pos < max)
+                        max = (unsigned)(state->maplen - pos);
+                    if (LSEEK(state->fd, max, SEEK_CUR) == -1) {
+                        gz_error(state, Z_ERRNO, zstrerror());
+                        return -1;
+                    }
+                    strm->avail_in += max;
+                    return 0;
+                }
+            }
+        }
+#endif
         if (strm->avail_in) {       /* copy what's there to the start */
             unsigned char *p = state->in;
             unsigned const char *q = strm->next_in;
@@ -86,6 +137,7 @@ local int gz_avail(state)
 local int gz_look(state)
     gz_statep state;
 {
+    unsigned n;
     z_streamp strm = &(state->strm);
 
     /* allocate read buffers and inflate memory */
@@ -102,6 +154,10 @@ local int gz_look(state)
             return -1;
         }
         state->size = state->want;
+#ifdef GZ_MMAP
+        if (state->mapok)
+            gz_map(state);
+#endif
 
         /* allocate inflate memory */
         state->strm.zalloc = Z_NULL;
@@ -118,6 +174,22 @@ local int gz_look(state)
         }
     }
 
+    /* skip the trailer of a member that was entered at an access point -- its
+       check value can't be verified, since not all of the data was seen */
+    while (state->trail) {
+        if (strm->avail_in == 0 && gz_avail(state) == -1)
+            return -1;
+        if (strm->avail_in == 0) {
+            gz_error(state, Z_BUF_ERROR, "unexpected end of file");
+            state->trail = 0;
+            return 0;
+        }
+        n = strm->avail_in < state->trail ? strm->avail_in : state->trail;
+        strm->next_in += n;
+        strm->avail_in -= n;
+        state->trail -= n;
+    }
+
     /* get at least the magic bytes in the input buffer */
     if (strm->avail_in < 2) {
         if (gz_avail(state) == -1)
@@ -135,7 +207,7 @@ local int gz_look(state)
        single byte is sufficient indication that it is not a gzip file) */
     if (strm->avail_in > 1 &&
             strm->next_in[0] == 31 && strm->next_in[1] == 139) {
-        inflateReset(strm);
+        inflateReset2(strm, 15 + 16);   /* may have been raw after a jump */
         state->how = GZIP;
         state->direct = 0;
         return 0;
@@ -154,6 +226,16 @@ local int gz_look(state)
        the output buffer is larger than the input buffer, which also assures
        space for gzungetc() */
     state->x.next = state->out;
+#ifdef GZ_MMAP
+    if (state->map != NULL && strm->avail_in) {
+        /* input from the mapping can be larger -- put it back to read */
+        if (LSEEK(state->fd, -(z_off64_t)strm->avail_in, SEEK_CUR) == -1) {
+            gz_error(state, Z_ERRNO, zstrerror());
+            return -1;
+        }
+        strm->avail_in = 0;
+    }
+#endif
     if (strm->avail_in) {
         memcpy(state->x.next, strm->next_in, strm->avail_in);
         state->x.have = strm->avail_in;
@@ -164,6 +246,109 @@ local int gz_look(state)
     return 0;
 }
 
+/* Record an access point at the current deflate block boundary, which is at
+   offset out in the uncompressed data, if it is at least span bytes past the
+   last one.  Access points are only an optimization, so if the file is not
+   seekable or memory runs out, recording just stops. */
+local void gz_mark(state, out)
+    gz_statep state;
+    z_off64_t out;
+{
+    z_off64_t pos;
+    gz_point *point;
+    z_streamp strm = &(state->strm);
+
+    if (out - (state->npoints ? state->points[state->npoints - 1].out : 0) <
+            (z_off64_t)state->span)
+        return;
+    pos = LSEEK(state->fd, 0, SEEK_CUR);
+    if (pos == -1) {
+        state->span = 0;
+        return;
+    }
+    if (state->npoints == state->maxpoints) {
+        point = (gz_point *)realloc(state->points, sizeof(gz_point) *
+                                    (state->maxpoints ? state->maxpoints << 1 :
+                                                        8));
+        if (point == NULL) {
+            state->span = 0;
+            return;
+        }
+        state->points = point;
+        state->maxpoints = state->maxpoints ? state->maxpoints << 1 : 8;
+    }
+    point = state->points + state->npoints;
+    point->window = (unsigned char *)malloc(32768U);
+    if (point->window == NULL) {
+        state->span = 0;
+        return;
+    }
+    inflateGetDictionary(strm, point->window, &point->wsize);
+    point->in = pos - strm->avail_in;
+    point->out = out;
+    point->bits = strm->data_type & 7;
+    state->npoints++;
+}
+
+/* Move to the last access point at or before target, if that saves
+   decompressing: if it is past the current position, or if target is behind
+   the current position.  Return 1 if moved, 0 if not, or -1 on error. */
+int ZLIB_INTERNAL gz_jump(state, target)
+    gz_statep state;
+    z_off64_t target;
+{
+    unsigned lo, hi, mid, got;
+    gz_point *point;
+    z_streamp strm = &(state->strm);
+
+    /* find the access point */
+    if (state->npoints == 0 || state->points[0].out > target)
+        return 0;
+    lo = 0;
+    hi = state->npoints;
+    while (hi - lo > 1) {
+        mid = lo + ((hi - lo) >> 1);
+        if (state->points[mid].out <= target)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    point = state->points + lo;
+    if (target >= state->x.pos && point->out <= state->x.pos)
+        return 0;
+
+    /* restart raw inflate there, with any leftover bits and the history */
+    if (LSEEK(state->fd, point->in - (point->bits ? 1 : 0), SEEK_SET) == -1)
+        return -1;
+    state->x.have = 0;
+    state->eof = 0;
+    state->past = 0;
+    state->seek = 0;
+    gz_error(state, Z_OK, NULL);
+    strm->avail_in = 0;
+    if (inflateReset2(strm, -15) != Z_OK) {
+        gz_error(state, Z_STREAM_ERROR, "internal error: inflate reset");
+        return -1;
+    }
+    if (point->bits) {
+        if (gz_load(state, state->in, 1, &got) == -1)
+            return -1;
+        if (got == 0) {
+            gz_error(state, Z_DATA_ERROR, "file changed since access point");
+            return -1;
+        }
+        inflatePrime(strm, point->bits, state->in[0] >> (8 - point->bits));
+    }
+    if (point->wsize)
+        inflateSetDictionary(strm, point->window, point->wsize);
+    state->raw = 1;
+    state->trail = 0;
+    state->how = GZIP;
+    state->direct = 0;
+    state->x.pos = point->out;
+    return 1;
+}
+
 /* Decompress from input to the provided next_out and avail_out in the state.
    On return, state->x.have and state->x.next point to the just decompressed
    data.  If the gzip stream completes, state->how is reset to LOOK to look for
@@ -187,8 +372,9 @@ local int gz_decomp(state)
             break;
         }
 
-        /* decompress and handle errors */
-        ret = inflate(strm, Z_NO_FLUSH);
+        /* decompress and handle errors -- stop at block boundaries if
+           recording access points */
+        ret = inflate(strm, state->span ? Z_BLOCK : Z_NO_FLUSH);
         if (ret == Z_STREAM_ERROR || ret == Z_NEED_DICT) {
             gz_error(state, Z_STREAM_ERROR,
                      "internal error: inflate stream corrupt");
@@ -203,6 +389,8 @@ local int gz_decomp(state)
                      strm->msg == NULL ? "compressed data error" : strm->msg);
             return -1;
         }
+        if (state->span && (strm->data_type & 192) == 128 && ret == Z_OK)
+            gz_mark(state, state->x.pos + had - strm->avail_out);
     } while (strm->avail_out && ret != Z_STREAM_END);
 
     /* update available output */
@@ -210,8 +398,13 @@ local int gz_decomp(state)
     state->x.next = strm->next_out - state->x.have;
 
     /* if the gzip stream completed successfully, look for another */
-    if (ret == Z_STREAM_END)
+    if (ret == Z_STREAM_END) {
         state->how = LOOK;
+        if (state->raw) {
+            state->raw = 0;
+            state->trail = 8;
+        }
+    }
 
     /* good decompression */
     return 0;
@@ -585,6 +778,13 @@ int ZEXPORT gzclose_r(file)
         free(state->out);
         free(state->in);
     }
+    while (state->npoints)
+        free(state->points[--state->npoints].window);
+    free(state->points);
+#ifdef GZ_MMAP
+    if (state->map != NULL)
+        munmap(state->map, (size_t)state->maplen);
+#endif
     err = state->err == Z_BUF_ERROR ? Z_BUF_ERROR : Z_OK;
     gz_error(state, Z_OK, NULL);
     free(state->path);
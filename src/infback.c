@@ -64,8 +64,10 @@ int stream_size;
     state->wbits = windowBits;
     state->wsize = 1U << windowBits;
     state->window = window;
+    state->contig = 0;
     state->wnext = 0;
     state->whave = 0;
+    state->keptlen = 0;
     return Z_OK;
 }
 
@@ -118,6 +120,7 @@ struct inflate_state FAR *state;
 #endif /* BUILDFIXED */
     state->lencode = lenfix;
     state->lenbits = 9;
+    state->paircode = lenfix;
     state->distcode = distfix;
     state->distbits = 5;
 }
@@ -382,7 +385,7 @@ void FAR *out_desc;
             }
             while (state->have < 19)
                 state->lens[order[state->have++]] = 0;
-            state->next = state->codes;
+            state->next = state->lenlens;
             state->lencode = (code const FAR *)(state->next);
             state->lenbits = 7;
             ret = inflate_table(CODES, state->lens, 19, &(state->next),
@@ -453,12 +456,32 @@ void FAR *out_desc;
                 break;
             }
 
-            /* build code tables -- note: do not change the lenbits or distbits
-               values here (9 and 6) without reading the comments in inftrees.h
-               concerning the ENOUGH constants, which depend on those values */
+            /* reuse the code tables of the last dynamic block if the code
+               lengths are the same, as they often are for a series of small
+               flushed blocks */
+            if (state->keptlen == state->nlen &&
+                state->keptdist == state->ndist &&
+                zmemcmp((const Bytef *)state->kept,
+                        (const Bytef *)state->lens,
+                        (state->nlen + state->ndist) *
+                        sizeof(unsigned short)) == 0) {
+                state->lencode = (code const FAR *)(state->codes);
+                state->lenbits = state->keptlenbits;
+                state->distcode = state->keptdistcode;
+                state->distbits = state->keptdistbits;
+                state->paircode = (code const FAR *)(state->pairs);
+                Tracev((stderr, "inflate:       codes kept\n"));
+                state->mode = LEN;
+                break;
+            }
+
+            /* build code tables -- note: the lenbits and distbits values here
+               are set in inftrees.h, along with the ENOUGH constants, which
+               depend on those values */
+            state->keptlen = 0;
             state->next = state->codes;
             state->lencode = (code const FAR *)(state->next);
-            state->lenbits = 9;
+            state->lenbits = INFLATE_LEN_BITS;
             ret = inflate_table(LENS, state->lens, state->nlen, &(state->next),
                                 &(state->lenbits), state->work);
             if (ret) {
@@ -467,7 +490,7 @@ void FAR *out_desc;
                 break;
             }
             state->distcode = (code const FAR *)(state->next);
-            state->distbits = 6;
+            state->distbits = INFLATE_DIST_BITS;
             ret = inflate_table(DISTS, state->lens + state->nlen, state->ndist,
                             &(state->next), &(state->distbits), state->work);
             if (ret) {
@@ -475,12 +498,22 @@ void FAR *out_desc;
                 state->mode = BAD;
                 break;
             }
+            inflate_pairs(state->pairs, state->lencode, state->lenbits);
+            state->paircode = (code const FAR *)(state->pairs);
+            zmemcpy((Bytef *)state->kept, (const Bytef *)state->lens,
+                    (state->nlen + state->ndist) * sizeof(unsigned short));
+            state->keptlen = state->nlen;
+            state->keptdist = state->ndist;
+            state->keptlenbits = state->lenbits;
+            state->keptdistbits = state->distbits;
+            state->keptdistcode = state->distcode;
             Tracev((stderr, "inflate:       codes ok\n"));
             state->mode = LEN;
 
         case LEN:
             /* use inflate_fast() if we have enough input and output */
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_MIN_INPUT &&
+                left >= INFLATE_FAST_MIN_OUTPUT) {
                 RESTORE();
                 if (state->whave < state->wsize)
                     state->whave = state->wsize - left;
@@ -29,6 +29,75 @@
 #  define PUP(a) *++(a)
 #endif
 
+#ifdef INFLATE_WORDS
+/* Top up hold to 56..63 bits with an eight-byte little-endian load, and
+   advance in over just the whole bytes that fit.  Any bits of the next byte
+   loaded above bits are the same when that byte is loaded again, so they are
+   or'ed back in harmlessly, and are masked off on return. */
+#  define REFILL() \
+    do { \
+        unsigned long word; \
+        zmemcpy(&word, in + OFF, 8); \
+        hold |= word << bits; \
+        op = (63 - bits) >> 3; \
+        in += op; \
+        bits += op << 3; \
+    } while (0)
+
+local unsigned char FAR *copy_match OF((unsigned char FAR *out,
+                                        unsigned dist, unsigned len));
+
+/* Copy a match of len bytes from dist bytes back to out, and return out + len.
+   Distances of 32 or more are copied eight bytes at a time, with the last
+   copy ending at the end of the match and so copying some bytes a second
+   time, in order to write nothing past the match.  Matches shorter than eight
+   bytes take two overlapping four-byte copies, or three single bytes.  Shorter
+   distances are copied by doubling: the bytes from the start of the match
+   through what's been written so far repeat the pattern, so each copy can be
+   twice as long as the last.  (Eight-byte copies at a short distance would
+   load data that straddles the preceding stores, which stalls on current
+   processors.) */
+local unsigned char FAR *copy_match(out, dist, len)
+    unsigned char FAR *out;
+    unsigned dist;
+    unsigned len;
+{
+    unsigned char FAR *end = out + len;
+    unsigned char FAR *from = out - dist;
+
+    if (dist < 32) {
+        do {
+            len = (unsigned)(out - from);
+            if (len > (unsigned)(end - out))
+                len = (unsigned)(end - out);
+            zmemcpy(out, from, len);
+            out += len;
+        } while (out < end);
+        return end;
+    }
+    if (len < 8) {
+        if (len < 4) {
+            out[0] = from[0];
+            out[1] = from[1];
+            out[2] = from[2];
+        }
+        else {
+            zmemcpy(out, from, 4);
+            zmemcpy(end - 4, end - 4 - dist, 4);
+        }
+        return end;
+    }
+    while (len > 8) {
+        zmemcpy(out, from, 8);
+        out += 8;
+        from += 8;
+        len -= 8;
+    }
+    zmemcpy(end - 8, end - 8 - dist, 8);
+    return end;
+}
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -40,8 +109,8 @@
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
-        strm->avail_out >= 258
+        strm->avail_in >= INFLATE_FAST_MIN_INPUT
+        strm->avail_out >= INFLATE_FAST_MIN_OUTPUT
         start >= strm->avail_out
         state->bits < 8
 
@@ -57,7 +126,16 @@
       length code, 5 bits for the length extra, 15 bits for the distance code,
       and 13 bits for the distance extra.  This totals 48 bits, or six bytes.
       Therefore if strm->avail_in >= 6, then there is enough input to avoid
-      checking for available input while decoding.
+      checking for available input while decoding.  With INFLATE_WORDS, hold
+      is refilled to at least 56 bits once per code from an eight-byte load,
+      so eight bytes must be available, and then no further refills are needed
+      for the length/distance pair.
+
+    - Nothing is written past the output produced, so the application's bytes
+      in the output buffer after strm->next_out on return are left unchanged.
+      Literal pairs store the second literal first, so that for a single
+      literal it is overwritten by the first, and matches are copied with
+      overlapping copies that end at the end of the match.
 
     - The maximum bytes that a single length/distance pair can output is 258
       bytes, which is the maximum length that can be coded.  inflate_fast()
@@ -84,6 +162,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     unsigned long hold;         /* local strm->hold */
     unsigned bits;              /* local strm->bits */
     code const FAR *lcode;      /* local strm->lencode */
+    code const FAR *pcode;      /* local strm->paircode */
     code const FAR *dcode;      /* local strm->distcode */
     unsigned lmask;             /* mask for first level of length codes */
     unsigned dmask;             /* mask for first level of distance codes */
@@ -97,10 +176,10 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_INPUT - 1));
     out = strm->next_out - OFF;
-    beg = out - (start - strm->avail_out);
-    end = out + (strm->avail_out - 257);
+    beg = out - (start - strm->avail_out) - BEHIND(state);
+    end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUTPUT - 1));
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -111,6 +190,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     hold = state->hold;
     bits = state->bits;
     lcode = state->lencode;
+    pcode = state->paircode;
     dcode = state->distcode;
     lmask = (1U << state->lenbits) - 1;
     dmask = (1U << state->distbits) - 1;
@@ -118,43 +198,54 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
+#ifdef INFLATE_WORDS
+        REFILL();
+#else
         if (bits < 15) {
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
         }
-        here = lcode[hold & lmask];
+#endif
+        here = pcode[hold & lmask];
       dolen:
         op = (unsigned)(here.bits);
         hold >>= op;
         bits -= op;
         op = (unsigned)(here.op);
-        if (op == 0) {                          /* literal */
-            Tracevv((stderr, here.val >= 0x20 && here.val < 0x7f ?
-                    "inflate:         literal '%c'\n" :
-                    "inflate:         literal 0x%02x\n", here.val));
-            PUP(out) = (unsigned char)(here.val);
+        if ((op & 127) == 0) {                  /* one or two literals */
+            Tracevv((stderr, op ? "inflate:         literals 0x%02x 0x%02x\n" :
+                    "inflate:         literal 0x%02x\n", here.val & 0xff,
+                    here.val >> 8));
+            op >>= 7;                           /* one if two literals */
+            out[OFF + op] = (unsigned char)(here.val >> 8);
+            out[OFF] = (unsigned char)(here.val);
+            out += 1 + op;
         }
         else if (op & 16) {                     /* length base */
             len = (unsigned)(here.val);
             op &= 15;                           /* number of extra bits */
             if (op) {
+#ifndef INFLATE_WORDS
                 if (bits < op) {
                     hold += (unsigned long)(PUP(in)) << bits;
                     bits += 8;
                 }
+#endif
                 len += (unsigned)hold & ((1U << op) - 1);
                 hold >>= op;
                 bits -= op;
             }
             Tracevv((stderr, "inflate:         length %u\n", len));
+#ifndef INFLATE_WORDS
             if (bits < 15) {
                 hold += (unsigned long)(PUP(in)) << bits;
                 bits += 8;
                 hold += (unsigned long)(PUP(in)) << bits;
                 bits += 8;
             }
+#endif
             here = dcode[hold & dmask];
           dodist:
             op = (unsigned)(here.bits);
@@ -164,6 +255,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
             if (op & 16) {                      /* distance base */
                 dist = (unsigned)(here.val);
                 op &= 15;                       /* number of extra bits */
+#ifndef INFLATE_WORDS
                 if (bits < op) {
                     hold += (unsigned long)(PUP(in)) << bits;
                     bits += 8;
@@ -172,6 +264,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         bits += 8;
                     }
                 }
+#endif
                 dist += (unsigned)hold & ((1U << op) - 1);
 #ifdef INFLATE_STRICT
                 if (dist > dmax) {
@@ -266,6 +359,9 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                     }
                 }
                 else {
+#ifdef INFLATE_WORDS
+                    out = copy_match(out + OFF, dist, len) - OFF;
+#else
                     from = out - dist;          /* copy direct from output */
                     do {                        /* minimum length is three */
                         PUP(out) = PUP(from);
@@ -278,6 +374,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         if (len > 1)
                             PUP(out) = PUP(from);
                     }
+#endif
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -315,9 +412,12 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* update state and return */
     strm->next_in = in + OFF;
     strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_INPUT - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_INPUT - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
-                                 257 + (end - out) : 257 - (out - end));
+                                 (INFLATE_FAST_MIN_OUTPUT - 1) + (end - out) :
+                                 (INFLATE_FAST_MIN_OUTPUT - 1) - (out - end));
     state->hold = hold;
     state->bits = bits;
     return;
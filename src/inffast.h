@@ -8,4 +8,25 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/* On 64-bit little-endian processors with fast unaligned loads and a 64-bit
+   unsigned long, inflate_fast() refills its bit accumulator with one
+   eight-byte load per code, which then holds enough bits for a complete
+   length/distance pair.  Define NO_INFLATE_WORDS to refill a byte at a time.
+ */
+#if !defined(ASMINF) && !defined(NO_INFLATE_WORDS) && defined(__GNUC__) && \
+    defined(ULONG_MAX) && (ULONG_MAX == 0xffffffffffffffff) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#  define INFLATE_WORDS
+#endif
+
+/* minimum input and output available for inflate() to call inflate_fast()
+   -- with INFLATE_WORDS, the input is loaded eight bytes at a time */
+#ifdef INFLATE_WORDS
+#  define INFLATE_FAST_MIN_INPUT 8
+#else
+#  define INFLATE_FAST_MIN_INPUT 6
+#endif
+#define INFLATE_FAST_MIN_OUTPUT 258
+
 void ZLIB_INTERNAL inflate_fast OF((z_streamp strm, unsigned start));
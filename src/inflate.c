@@ -91,6 +91,14 @@
 #  endif
 #endif
 
+/* When inflate() is asked to finish with less than this much output space
+   left, as for uncompress() of a short buffer, the code tables of a dynamic
+   block are built with a smaller root table and without the literal pairs,
+   which take longer to build than they save on that little output. */
+#ifndef INFLATE_SHORT
+#  define INFLATE_SHORT 4096
+#endif
+
 /* function prototypes */
 local void fixedtables OF((struct inflate_state FAR *state));
 local int updatewindow OF((z_streamp strm, const unsigned char FAR *end,
@@ -120,6 +128,9 @@ z_streamp strm;
     state->hold = 0;
     state->bits = 0;
     state->lencode = state->distcode = state->next = state->codes;
+    state->paircode = state->pairs;
+    state->keptlen = 0;
+    state->contig = 0;
     state->sane = 1;
     state->back = -1;
     Tracev((stderr, "inflate: reset\n"));
@@ -219,6 +230,47 @@ int stream_size;
     return ret;
 }
 
+uLong ZEXPORT inflateStateSize(windowBits)
+int windowBits;
+{
+    /* same window size as inflateReset2() and inflate() will use */
+    if (windowBits < 0)
+        windowBits = -windowBits;
+#ifdef GUNZIP
+    else if (windowBits < 48)
+        windowBits &= 15;
+#endif
+    if (windowBits == 0)
+        windowBits = 15;            /* the most that a zlib header allows */
+    if (windowBits < 8 || windowBits > 15)
+        return 0;
+
+    /* the allocations made by inflateInit2_() and updatewindow() */
+    return Z_ARENA_HEAD + Z_ARENA_SIZE(sizeof(struct inflate_state)) +
+           Z_ARENA_SIZE(1UL << windowBits);
+}
+
+int ZEXPORT inflateInitArena_(strm, windowBits, mem, size, version,
+                              stream_size)
+z_streamp strm;
+int windowBits;
+voidpf mem;
+uLong size;
+const char *version;
+int stream_size;
+{
+    uLong need;
+
+    if (strm == Z_NULL || mem == Z_NULL) return Z_STREAM_ERROR;
+    need = inflateStateSize(windowBits);
+    if (need == 0) return Z_STREAM_ERROR;
+    if (size < need) return Z_MEM_ERROR;
+    strm->zalloc = zaralloc;
+    strm->zfree = zarfree;
+    strm->opaque = zarena(mem, size);
+    return inflateInit2_(strm, windowBits, version, stream_size);
+}
+
 int ZEXPORT inflateInit_(strm, version, stream_size)
 z_streamp strm;
 const char *version;
@@ -297,6 +349,7 @@ struct inflate_state FAR *state;
 #endif /* BUILDFIXED */
     state->lencode = lenfix;
     state->lenbits = 9;
+    state->paircode = lenfix;
     state->distcode = distfix;
     state->distbits = 5;
 }
@@ -920,7 +973,7 @@ int flush;
             }
             while (state->have < 19)
                 state->lens[order[state->have++]] = 0;
-            state->next = state->codes;
+            state->next = state->lenlens;
             state->lencode = (const code FAR *)(state->next);
             state->lenbits = 7;
             ret = inflate_table(CODES, state->lens, 19, &(state->next),
@@ -991,12 +1044,34 @@ int flush;
                 break;
             }
 
-            /* build code tables -- note: do not change the lenbits or distbits
-               values here (9 and 6) without reading the comments in inftrees.h
-               concerning the ENOUGH constants, which depend on those values */
+            /* reuse the code tables of the last dynamic block if the code
+               lengths are the same, as they often are for a series of small
+               flushed blocks */
+            if (state->keptlen == state->nlen &&
+                state->keptdist == state->ndist &&
+                zmemcmp((const Bytef *)state->kept,
+                        (const Bytef *)state->lens,
+                        (state->nlen + state->ndist) *
+                        sizeof(unsigned short)) == 0) {
+                state->lencode = (const code FAR *)(state->codes);
+                state->lenbits = state->keptlenbits;
+                state->distcode = state->keptdistcode;
+                state->distbits = state->keptdistbits;
+                state->paircode = (const code FAR *)(state->pairs);
+                Tracev((stderr, "inflate:       codes kept\n"));
+                state->mode = LEN_;
+                if (flush == Z_TREES) goto inf_leave;
+                break;
+            }
+
+            /* build code tables -- note: the lenbits and distbits values here
+               are set in inftrees.h, along with the ENOUGH constants, which
+               depend on those values */
+            state->keptlen = 0;
             state->next = state->codes;
             state->lencode = (const code FAR *)(state->next);
-            state->lenbits = 9;
+            state->lenbits = flush == Z_FINISH && left < INFLATE_SHORT ?
+                             9 : INFLATE_LEN_BITS;
             ret = inflate_table(LENS, state->lens, state->nlen, &(state->next),
                                 &(state->lenbits), state->work);
             if (ret) {
@@ -1005,7 +1080,7 @@ int flush;
                 break;
             }
             state->distcode = (const code FAR *)(state->next);
-            state->distbits = 6;
+            state->distbits = INFLATE_DIST_BITS;
             ret = inflate_table(DISTS, state->lens + state->nlen, state->ndist,
                             &(state->next), &(state->distbits), state->work);
             if (ret) {
@@ -1013,13 +1088,28 @@ int flush;
                 state->mode = BAD;
                 break;
             }
+            if (flush == Z_FINISH && left < INFLATE_SHORT)
+                /* too little output left to pay for the pairs */
+                state->paircode = state->lencode;
+            else {
+                inflate_pairs(state->pairs, state->lencode, state->lenbits);
+                state->paircode = (const code FAR *)(state->pairs);
+                zmemcpy((Bytef *)state->kept, (const Bytef *)state->lens,
+                        (state->nlen + state->ndist) * sizeof(unsigned short));
+                state->keptlen = state->nlen;
+                state->keptdist = state->ndist;
+                state->keptlenbits = state->lenbits;
+                state->keptdistbits = state->distbits;
+                state->keptdistcode = state->distcode;
+            }
             Tracev((stderr, "inflate:       codes ok\n"));
             state->mode = LEN_;
             if (flush == Z_TREES) goto inf_leave;
         case LEN_:
             state->mode = LEN;
         case LEN:
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_MIN_INPUT &&
+                left >= INFLATE_FAST_MIN_OUTPUT) {
                 RESTORE();
                 inflate_fast(strm, out);
                 LOAD();
@@ -1122,7 +1212,7 @@ int flush;
             state->mode = MATCH;
         case MATCH:
             if (left == 0) goto inf_leave;
-            copy = out - left;
+            copy = out - left + BEHIND(state);
             if (state->offset > copy) {         /* copy from window */
                 copy = state->offset - copy;
                 if (copy > state->whave) {
@@ -1224,13 +1314,14 @@ int flush;
     /*
        Return from inflate(), updating the total counts and the check value.
        If there was no progress during the inflate() call, return a buffer
-       error.  Call updatewindow() to create and/or update the window state.
-       Note: a memory error from inflate() is non-recoverable.
+       error.  Call updatewindow() to create and/or update the window state,
+       unless the earlier output is kept in place by the application.  Note: a
+       memory error from inflate() is non-recoverable.
      */
   inf_leave:
     RESTORE();
-    if (state->wsize || (out != strm->avail_out && state->mode < BAD &&
-            (state->mode < CHECK || flush != Z_FINISH)))
+    if (!state->contig && (state->wsize || (out != strm->avail_out &&
+            state->mode < BAD && (state->mode < CHECK || flush != Z_FINISH))))
         if (updatewindow(strm, strm->next_out, out - strm->avail_out)) {
             state->mode = MEM;
             return Z_MEM_ERROR;
@@ -1271,11 +1362,35 @@ Bytef *dictionary;
 uInt *dictLength;
 {
     struct inflate_state FAR *state;
+    unsigned have, back;
 
     /* check state */
     if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
     state = (struct inflate_state FAR *)strm->state;
 
+    /* with contiguous output, the window has only the dictionary given to
+       inflateSetDictionary(), and that is followed by the output */
+    if (state->contig) {
+        back = BEHIND(state);
+        have = (1U << state->wbits) - back;
+        if (have > state->whave) have = state->whave;
+        if (dictionary != Z_NULL) {
+            if (have > state->wnext) {
+                zmemcpy(dictionary, state->window + state->whave -
+                        (have - state->wnext), have - state->wnext);
+                zmemcpy(dictionary + have - state->wnext, state->window,
+                        state->wnext);
+            }
+            else if (have)
+                zmemcpy(dictionary, state->window + state->wnext - have, have);
+            if (back)
+                zmemcpy(dictionary + have, strm->next_out - back, back);
+        }
+        if (dictLength != Z_NULL)
+            *dictLength = have + back;
+        return Z_OK;
+    }
+
     /* copy dictionary */
     if (state->whave && dictionary != Z_NULL) {
         zmemcpy(dictionary, state->window + state->wnext,
@@ -1302,6 +1417,8 @@ uInt dictLength;
     state = (struct inflate_state FAR *)strm->state;
     if (state->wrap != 0 && state->mode != DICT)
         return Z_STREAM_ERROR;
+    if (state->contig && state->total)  /* would go after the output */
+        return Z_STREAM_ERROR;
 
     /* check for correct dictionary identifier */
     if (state->mode == DICT) {
@@ -1380,6 +1497,7 @@ z_streamp strm;
     unsigned len;               /* number of bytes to look at or looked at */
     unsigned long in, out;      /* temporary to save total_in and total_out */
     unsigned char buf[4];       /* to restore bit buffer to byte string */
+    int contig;                 /* to keep contiguous output through reset */
     struct inflate_state FAR *state;
 
     /* check parameters */
@@ -1411,8 +1529,10 @@ z_streamp strm;
     /* return no joy or set up to restart inflate() on a new block */
     if (state->have != 4) return Z_DATA_ERROR;
     in = strm->total_in;  out = strm->total_out;
+    contig = state->contig;
     inflateReset(strm);
     strm->total_in = in;  strm->total_out = out;
+    state->contig = contig;
     state->mode = TYPE;
     return Z_OK;
 }
@@ -1448,6 +1568,8 @@ z_streamp source;
     if (dest == Z_NULL || source == Z_NULL || source->state == Z_NULL ||
         source->zalloc == (alloc_func)0 || source->zfree == (free_func)0)
         return Z_STREAM_ERROR;
+    if (source->zalloc == zaralloc)
+        return Z_STREAM_ERROR;  /* no room in the arena for a copy */
     state = (struct inflate_state FAR *)source->state;
 
     /* allocate space */
@@ -1472,7 +1594,19 @@ z_streamp source;
         copy->lencode = copy->codes + (state->lencode - state->codes);
         copy->distcode = copy->codes + (state->distcode - state->codes);
     }
-    copy->next = copy->codes + (state->next - state->codes);
+    else if (state->lencode == state->lenlens)
+        copy->lencode = copy->lenlens;
+    if (state->paircode == state->pairs)
+        copy->paircode = copy->pairs;
+    else if (state->paircode == state->lencode)
+        copy->paircode = copy->lencode;
+    if (state->keptlen)
+        copy->keptdistcode = copy->codes +
+                             (state->keptdistcode - state->codes);
+    if (state->next >= state->lenlens && state->next <= state->lenlens + 128)
+        copy->next = copy->lenlens + (state->next - state->lenlens);
+    else
+        copy->next = copy->codes + (state->next - state->codes);
     if (window != Z_NULL) {
         wsize = 1U << state->wbits;
         zmemcpy(window, state->window, wsize);
@@ -1499,6 +1633,19 @@ int subvert;
 #endif
 }
 
+int ZEXPORT inflateContiguous(strm, contig)
+z_streamp strm;
+int contig;
+{
+    struct inflate_state FAR *state;
+
+    if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
+    state = (struct inflate_state FAR *)strm->state;
+    if (state->total) return Z_STREAM_ERROR;
+    state->contig = contig != 0;
+    return Z_OK;
+}
+
 long ZEXPORT inflateMark(strm)
 z_streamp strm;
 {
@@ -94,6 +94,8 @@ struct inflate_state {
     unsigned whave;             /* valid bytes in the window */
     unsigned wnext;             /* window write index */
     unsigned char FAR *window;  /* allocated sliding window, if needed */
+    int contig;                 /* true if earlier output is before next_out,
+                                   so the window only holds a dictionary */
         /* bit accumulator */
     unsigned long hold;         /* input bit accumulator */
     unsigned bits;              /* number of bits in "in" */
@@ -105,6 +107,7 @@ struct inflate_state {
         /* fixed and dynamic code tables */
     code const FAR *lencode;    /* starting table for length/literal codes */
     code const FAR *distcode;   /* starting table for distance codes */
+    code const FAR *paircode;   /* lencode root with literal pairs */
     unsigned lenbits;           /* index bits for lencode */
     unsigned distbits;          /* index bits for distcode */
         /* dynamic table building */
@@ -116,7 +119,25 @@ struct inflate_state {
     unsigned short lens[320];   /* temporary storage for code lengths */
     unsigned short work[288];   /* work area for code table building */
     code codes[ENOUGH];         /* space for code tables */
+    code pairs[1U << INFLATE_LEN_BITS]; /* space for paircode */
+    code lenlens[128];          /* space for code length code table */
+        /* reuse of the last dynamic code tables */
+    unsigned short kept[320];   /* code lengths of the tables kept in codes[] */
+    unsigned keptlen;           /* nlen for kept[], or zero if none kept */
+    unsigned keptdist;          /* ndist for kept[] */
+    unsigned keptlenbits;       /* lenbits for the kept tables */
+    unsigned keptdistbits;      /* distbits for the kept tables */
+    code const FAR *keptdistcode;   /* distcode for the kept tables */
     int sane;                   /* if false, allow invalid distance too far */
     int back;                   /* bits back of last unprocessed length/lit */
     unsigned was;               /* initial length of match */
 };
+
+/* Number of bytes of earlier output just before next_out that can be referred
+   to by a distance when the output is contiguous: all of the output so far, up
+   to the window size.  The window holds only a dictionary, if any, which came
+   before all of that. */
+#define BEHIND(state) \
+    ((state)->contig && (state)->total ? \
+     ((state)->total < (1UL << (state)->wbits) ? (unsigned)((state)->total) : \
+      1U << (state)->wbits) : 0)
@@ -304,3 +304,42 @@ unsigned short FAR *work;
     *bits = root;
     return 0;
 }
+
+/*
+   Build a copy of the root table of a literal/length code for inflate_fast(),
+   in which each literal whose code leaves room in the root bits for the code
+   of another literal is replaced by an entry that decodes both: op is 128,
+   bits is the total length of the two codes, and val has the first literal in
+   the low byte and the second in the high byte.  Text is mostly short literal
+   codes, so this decodes many literals two at a time.  lcode is the table
+   built by inflate_table(), bits is its root table size, and pairs must have
+   room for 1 << bits entries.
+
+   The code for the second literal starts just after the first code, which in
+   the root table index is the index shifted down by the length of the first
+   code.  The high bits of that shifted index are zero instead of the next
+   input bits, so the entry found there is only correct if its code fits in
+   the bits that are left.
+ */
+void ZLIB_INTERNAL inflate_pairs(pairs, lcode, bits)
+code FAR *pairs;
+code const FAR *lcode;
+unsigned bits;
+{
+    unsigned idx;               /* index in root table */
+    code here;                  /* entry for first literal */
+    code next;                  /* entry for second literal */
+
+    for (idx = 0; idx < (1U << bits); idx++) {
+        here = lcode[idx];
+        if (here.op == 0) {
+            next = lcode[idx >> here.bits];
+            if (next.op == 0 && here.bits + next.bits <= bits) {
+                here.op = 128;
+                here.bits += next.bits;
+                here.val |= next.val << 8;
+            }
+        }
+        pairs[idx] = here;
+    }
+}
@@ -33,21 +33,53 @@ typedef struct {
     0001eeee - length or distance, eeee is the number of extra bits
     01100000 - end of block
     01000000 - invalid code
+   and by inflate_pairs():
+    10000000 - two literals, the first in the low byte of val
  */
 
-/* Maximum size of the dynamic table.  The maximum number of code structures is
-   1444, which is the sum of 852 for literal/length codes and 592 for distance
-   codes.  These values were found by exhaustive searches using the program
+/* Root table sizes in bits for dynamic literal/length and distance codes in
+   inflate() and inflateBack().  Codes no longer than the root are decoded
+   with one table lookup, and longer codes need a second lookup in a
+   sub-table.  A larger root means fewer second lookups in inflate_fast(), at
+   the cost of more table space and more time to build the tables for each
+   dynamic block.  The root sizes can be set at compile time to 9..12 bits for
+   literal/length codes and 6..9 bits for distance codes.  zlib 1.2.8 and
+   earlier used 9 and 6. */
+#ifndef INFLATE_LEN_BITS
+#  define INFLATE_LEN_BITS 10
+#endif
+#ifndef INFLATE_DIST_BITS
+#  define INFLATE_DIST_BITS 8
+#endif
+
+/* Maximum size of the dynamic table.  The maximum number of code structures
+   depends on the root table sizes above, and is 1732 for the defaults, which
+   is the sum of 1332 for literal/length codes and 400 for distance codes.
+   These values were found by exhaustive searches using the program
    examples/enough.c found in the zlib distribtution.  The arguments to that
    program are the number of symbols, the initial root table size, and the
-   maximum bit length of a code.  "enough 286 9 15" for literal/length codes
-   returns returns 852, and "enough 30 6 15" for distance codes returns 592.
-   The initial root table size (9 or 6) is found in the fifth argument of the
-   inflate_table() calls in inflate.c and infback.c.  If the root table size is
-   changed, then these maximum sizes would be need to be recalculated and
-   updated. */
-#define ENOUGH_LENS 852
-#define ENOUGH_DISTS 592
+   maximum bit length of a code.  "enough 286 10 15" for literal/length codes
+   returns 1332, and "enough 30 8 15" for distance codes returns 400.  If
+   other root table sizes are supported, then these maximum sizes need to be
+   calculated the same way and added here. */
+#if INFLATE_LEN_BITS == 9
+#  define ENOUGH_LENS 852
+#elif INFLATE_LEN_BITS == 10
+#  define ENOUGH_LENS 1332
+#elif INFLATE_LEN_BITS == 11
+#  define ENOUGH_LENS 2340
+#elif INFLATE_LEN_BITS == 12
+#  define ENOUGH_LENS 4380
+#else
+#  error INFLATE_LEN_BITS must be in 9..12
+#endif
+#if INFLATE_DIST_BITS == 6 || INFLATE_DIST_BITS == 9
+#  define ENOUGH_DISTS 592
+#elif INFLATE_DIST_BITS == 7 || INFLATE_DIST_BITS == 8
+#  define ENOUGH_DISTS 400
+#else
+#  error INFLATE_DIST_BITS must be in 6..9
+#endif
 #define ENOUGH (ENOUGH_LENS+ENOUGH_DISTS)
 
 /* Type of code to build for inflate_table() */
@@ -60,3 +92,5 @@ typedef enum {
 int ZLIB_INTERNAL inflate_table OF((codetype type, unsigned short FAR *lens,
                              unsigned codes, code FAR * FAR *table,
                              unsigned FAR *bits, unsigned short FAR *work));
+void ZLIB_INTERNAL inflate_pairs OF((code FAR *pairs, code const FAR *lcode,
+                             unsigned bits));
@@ -12,6 +12,9 @@
 #  include <string.h>
 #  include <stdlib.h>
 #endif
+#ifndef Z_SOLO
+#  include <fcntl.h>
+#endif
 
 #if defined(VMS) || defined(RISCOS)
 #  define TESTFILE "foo-gz"
@@ -47,6 +50,32 @@ void test_sync          OF((Byte *compr, uLong comprLen,
 void test_dict_deflate  OF((Byte *compr, uLong comprLen));
 void test_dict_inflate  OF((Byte *compr, uLong comprLen,
                             Byte *uncompr, uLong uncomprLen));
+void test_checksums     OF((Byte *buf, uLong len));
+void test_arena         OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_sized_deflate OF((Byte *compr, uLong comprLen));
+void test_header_deflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_reset_deflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_contig_inflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_kept_inflate  OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_tail_inflate  OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_quick_deflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_optimal_deflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_tree_deflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_split_deflate OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_prime         OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_crc_deflate   OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
 int  main               OF((int argc, char *argv[]));
 
 
@@ -81,6 +110,14 @@ void test_compress      OF((Byte *compr, uLong comprLen,
                             Byte *uncompr, uLong uncomprLen));
 void test_gzio          OF((const char *fname,
                             Byte *uncompr, uLong uncomprLen));
+void test_gzpio         OF((const char *fname, Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_gzindex       OF((const char *fname, Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_gzspan        OF((const char *fname, Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_zpool         OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
 
 /* ===========================================================================
  * Test compress() and uncompress()
@@ -123,6 +160,9 @@ void test_gzio(fname, uncompr, uncomprLen)
     int len = (int)strlen(hello)+1;
     gzFile file;
     z_off_t pos;
+    uLong i, n, big = 100000L;
+    Byte *data, *back;
+    FILE *plain;
 
     file = gzopen(fname, "wb");
     if (file == NULL) {
@@ -189,9 +229,568 @@ void test_gzio(fname, uncompr, uncomprLen)
     }
 
     gzclose(file);
+
+    /* files larger than the input buffer, opened with "m" so that they are
+       read from a mapping of the file when compiled with USE_MMAP: gzip data,
+       read in pieces and with a seek back, and a file that is not gzip, which
+       is copied */
+    data = (Byte*)malloc((size_t)big);
+    back = (Byte*)malloc((size_t)big + 1);
+    if (data == NULL || back == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (n = 1, i = 0; i < big; i++) {
+        n = (n * 1103515245UL + 12345) & 0xffffffffUL;
+        data[i] = (Byte)hello[(i * i) % 13] + (Byte)(n >> 27);
+    }
+    file = gzopen(fname, "wb1");
+    if (file == NULL || gzwrite(file, data, (unsigned)big) != (int)big) {
+        fprintf(stderr, "gzwrite error\n");
+        exit(1);
+    }
+    err = gzclose(file);
+    CHECK_ERR(err, "gzclose");
+    file = gzopen(fname, "rbm");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    for (i = 0; i < big; i += n) {
+        n = big - i < 30000L ? big - i : 30000L;
+        if (gzread(file, back + i, (unsigned)n) != (int)n) {
+            fprintf(stderr, "gzread err: %s\n", gzerror(file, &err));
+            exit(1);
+        }
+    }
+    if (memcmp(back, data, (size_t)big) ||
+        gzseek(file, 12345L, SEEK_SET) != 12345L ||
+        gzread(file, back, 1000) != 1000 ||
+        memcmp(back, data + 12345L, 1000)) {
+        fprintf(stderr, "bad gzread of a large file\n");
+        exit(1);
+    }
+    err = gzclose(file);
+    CHECK_ERR(err, "gzclose");
+
+    plain = fopen(fname, "wb");
+    if (plain == NULL || fwrite(data, 1, (size_t)big, plain) != big) {
+        fprintf(stderr, "cannot write %s\n", fname);
+        exit(1);
+    }
+    fclose(plain);
+    file = gzopen(fname, "rbm");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    if (gzread(file, back, (unsigned)big + 1) != (int)big ||
+        memcmp(back, data, (size_t)big) || !gzdirect(file)) {
+        fprintf(stderr, "bad gzread of a large plain file\n");
+        exit(1);
+    }
+    err = gzclose(file);
+    CHECK_ERR(err, "gzclose");
+    free(back);
+    free(data);
+    printf("gzread() of large files: OK\n");
+#endif
+}
+
+/* ===========================================================================
+ * Test writing a .gz file with several threads and reading it back
+ */
+void test_gzpio(fname, compr, comprLen, uncompr, uncomprLen)
+    const char *fname; /* compressed file name */
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err;
+    uLong i, rand, big = 1200000L;
+    int in, out;
+    gzpFile pfile;
+    gzFile file;
+    char *name;
+    FILE *scratch;
+    Byte *data, *back;
+
+    /* compressible data that spans several blocks */
+    for (i = 0; i < comprLen; i++)
+        compr[i] = (Byte)(hello[(i * 7) % 13] + ((i >> 9) & 3));
+
+    pfile = gzpdopen(open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644), 6, 3);
+    if (pfile == NULL) {
+        fprintf(stderr, "gzpdopen not supported\n");
+        return;
+    }
+    if (gzpbuffer(pfile, 4096, 4) != 0) {
+        fprintf(stderr, "gzpbuffer error\n");
+        exit(1);
+    }
+    if (gzpwrite(pfile, compr, 1000) != 1000 ||
+        gzpwrite(pfile, compr + 1000, (unsigned)comprLen - 1000) !=
+            (int)comprLen - 1000) {
+        fprintf(stderr, "gzpwrite error\n");
+        exit(1);
+    }
+    err = gzpclose(pfile);
+    CHECK_ERR(err, "gzpclose");
+
+    file = gzopen(fname, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    if (gzread(file, uncompr, (unsigned)uncomprLen) != (int)comprLen ||
+        memcmp(uncompr, compr, (size_t)comprLen)) {
+        fprintf(stderr, "bad gzread after gzpwrite: %s\n",
+                gzerror(file, &err));
+        exit(1);
+    }
+    err = gzclose(file);
+    CHECK_ERR(err, "gzclose");
+    printf("gzpwrite(): %lu bytes read back\n", comprLen);
+
+    /* decompress it again in parallel, to a scratch file */
+    name = (char*)malloc(strlen(fname) + 5);
+    if (name == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    strcpy(name, fname);
+    strcat(name, ".out");
+    in = open(fname, O_RDONLY);
+    out = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    err = gzpuncompress(in, out, 2);
+    CHECK_ERR(err, "gzpuncompress");
+    close(in);
+    close(out);
+    scratch = fopen(name, "rb");
+    if (scratch == NULL ||
+        fread(uncompr, 1, (size_t)uncomprLen, scratch) != comprLen ||
+        memcmp(uncompr, compr, (size_t)comprLen)) {
+        fprintf(stderr, "bad gzpuncompress\n");
+        exit(1);
+    }
+    fclose(scratch);
+
+    /* random data, which compresses to about its own length, with full
+       flushes after 300K and 900K, so that it is cut into three segments,
+       and a sync flush after 600K, which is also cut at but is followed by a
+       match with the data before it, so that segment needs the serial path */
+    data = (Byte*)malloc((size_t)big);
+    back = (Byte*)malloc((size_t)big + 1);
+    if (data == NULL || back == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    rand = 1;
+    for (i = 0; i < big; i++) {
+        rand = (rand * 1103515245UL + 12345) & 0xffffffffUL;
+        data[i] = (Byte)(rand >> 24);
+    }
+    memcpy(data + 600000L, data + 599000L, 1000);
+    file = gzopen(fname, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    for (i = 0; i < big; i += 300000L) {
+        if (gzwrite(file, data + i, 300000U) != 300000) {
+            fprintf(stderr, "gzwrite err: %s\n", gzerror(file, &err));
+            exit(1);
+        }
+        if (i + 300000L < big) {
+            err = gzflush(file, i == 300000L ? Z_SYNC_FLUSH : Z_FULL_FLUSH);
+            CHECK_ERR(err, "gzflush");
+        }
+    }
+    err = gzclose(file);
+    CHECK_ERR(err, "gzclose");
+
+    in = open(fname, O_RDONLY);
+    out = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    err = gzpuncompress(in, out, 4);
+    CHECK_ERR(err, "gzpuncompress");
+    close(in);
+    close(out);
+    scratch = fopen(name, "rb");
+    if (scratch == NULL || fread(back, 1, (size_t)big + 1, scratch) != big ||
+        memcmp(back, data, (size_t)big)) {
+        fprintf(stderr, "bad gzpuncompress of segments\n");
+        exit(1);
+    }
+    fclose(scratch);
+
+    /* the combined check value must match the trailer */
+    scratch = fopen(fname, "r+b");
+    if (scratch == NULL || fseek(scratch, -8L, SEEK_END) ||
+        fread(back, 1, 1, scratch) != 1 || fseek(scratch, -8L, SEEK_END) ||
+        fputc(back[0] ^ 1, scratch) == EOF) {
+        fprintf(stderr, "cannot change the trailer\n");
+        exit(1);
+    }
+    fclose(scratch);
+    in = open(fname, O_RDONLY);
+    out = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    err = gzpuncompress(in, out, 4);
+    close(in);
+    close(out);
+    if (err != Z_DATA_ERROR) {
+        fprintf(stderr, "gzpuncompress should report Z_DATA_ERROR\n");
+        exit(1);
+    }
+    free(back);
+    free(data);
+    remove(name);
+    free(name);
+    printf("gzpuncompress(): %lu bytes, %lu in segments\n", comprLen, big);
+}
+
+/* ===========================================================================
+ * Test random access reads with an index, after saving and loading it
+ */
+void test_gzindex(fname, compr, comprLen, uncompr, uncomprLen)
+    const char *fname; /* compressed file name */
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+#ifdef NO_GZCOMPRESS
+    fprintf(stderr, "NO_GZCOMPRESS -- gz* functions cannot compress\n");
+#else
+    int err, fd, n;
+    uLong i, offset, seed = 1;
+    gzFile file;
+    gzIndex index;
+
+    /* mostly literals, so that there are several deflate blocks */
+    for (i = 0; i < comprLen; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        compr[i] = (Byte)('a' + ((seed >> 16) & 15));
+    }
+    file = gzopen(fname, "wb");
+    if (file == NULL || gzwrite(file, compr, (unsigned)comprLen) !=
+                            (int)comprLen) {
+        fprintf(stderr, "gzopen or gzwrite error\n");
+        exit(1);
+    }
+    gzclose(file);
+
+    /* build with a small span to get several access points */
+    fd = open(fname, O_RDONLY);
+    n = gzindex_build(fd, 4096, &index);
+    if (n < 2) {
+        fprintf(stderr, "gzindex_build error: %d\n", n);
+        exit(1);
+    }
+    close(fd);
+    fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    err = gzindex_save(index, fd);
+    CHECK_ERR(err, "gzindex_save");
+    close(fd);
+    gzindex_free(index);
+    fd = open(fname, O_RDONLY);
+    if (gzindex_load(fd, &index) != n) {
+        fprintf(stderr, "gzindex_load error\n");
+        exit(1);
+    }
+    close(fd);
+
+    /* recreate the compressed file, and read pieces of it back */
+    file = gzopen(fname, "wb");
+    gzwrite(file, compr, (unsigned)comprLen);
+    gzclose(file);
+    fd = open(fname, O_RDONLY);
+    for (offset = 0; offset < comprLen; offset += 7777) {
+        n = gzindex_read(index, fd, (z_off_t)offset, uncompr, 1000);
+        if (n != (int)(comprLen - offset < 1000 ? comprLen - offset : 1000) ||
+            memcmp(uncompr, compr + offset, n)) {
+            fprintf(stderr, "bad gzindex_read at %lu\n", offset);
+            exit(1);
+        }
+    }
+    n = gzindex_read(index, fd, -100, uncompr, (unsigned)uncomprLen);
+    if (n != 100 || memcmp(uncompr, compr + comprLen - 100, 100)) {
+        fprintf(stderr, "bad gzindex_read of the end\n");
+        exit(1);
+    }
+    close(fd);
+    gzindex_free(index);
+    printf("gzindex_read(): OK\n");
+#endif
+}
+
+/* ===========================================================================
+ * Test seeking with access points, on two members each holding the data
+ * left in compr by test_gzindex()
+ */
+void test_gzspan(fname, compr, comprLen, uncompr, uncomprLen)
+    const char *fname; /* compressed file name */
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+#ifdef NO_GZCOMPRESS
+    fprintf(stderr, "NO_GZCOMPRESS -- gz* functions cannot compress\n");
+#else
+    int n;
+    uLong i, offset;
+    gzFile file;
+
+    (void)uncomprLen;   /* reads are 1000 bytes, well within uncompr */
+
+    file = gzopen(fname, "wb");
+    gzwrite(file, compr, (unsigned)comprLen);
+    gzclose(file);
+    file = gzopen(fname, "ab");
+    gzwrite(file, compr, (unsigned)comprLen);
+    gzclose(file);
+
+    /* record access points on a first pass */
+    file = gzopen(fname, "rb");
+    if (file == NULL || gzspan(file, 4096) != 0) {
+        fprintf(stderr, "gzopen or gzspan error\n");
+        exit(1);
+    }
+    while (gzread(file, uncompr, 1000) > 0)   /* leave uncompr mostly zero */
+        ;
+
+    /* seek backwards and forwards, reading after each seek */
+    for (i = 0; i < 16; i++) {
+        offset = ((i & 1 ? 15 - i : i) * 9973UL) % ((comprLen << 1) - 1000);
+        if (gzseek(file, (z_off_t)offset, SEEK_SET) != (z_off_t)offset) {
+            fprintf(stderr, "gzseek error: %s\n", gzerror(file, &n));
+            exit(1);
+        }
+        n = gzread(file, uncompr, 1000);
+        if (n == 1000)      /* may cross into the second member */
+            while (n && uncompr[n - 1] == compr[(offset + n - 1) % comprLen])
+                n--;
+        if (n) {
+            fprintf(stderr, "bad gzread after gzseek to %lu\n", offset);
+            exit(1);
+        }
+    }
+    gzseek(file, (z_off_t)(comprLen << 1) - 100, SEEK_SET);
+    n = gzread(file, uncompr, 1000);
+    if (n != 100 || memcmp(uncompr, compr + comprLen - 100, 100) ||
+        gzclose(file) != Z_OK) {
+        fprintf(stderr, "bad gzread after gzseek to the end\n");
+        exit(1);
+    }
+    printf("gzspan(): OK\n");
 #endif
 }
 
+/* ===========================================================================
+ * Test deflate() and inflate() with streams from a pool, checking that
+ * released streams are reused
+ */
+void test_zpool(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err, i;
+    unsigned long hits, misses;
+    uLong len, j;
+    gz_header head;
+    z_poolp pool;
+    z_streamp strm;
+    Byte out[100];
+
+    pool = zpoolOpen(2);
+    if (pool == NULL) {
+        fprintf(stderr, "zpoolOpen not supported\n");
+        return;
+    }
+    for (i = 0; i < 4; i++) {
+        strm = zpoolDeflate(pool, i == 3 ? 1 : 6, MAX_WBITS, 8,
+                            Z_DEFAULT_STRATEGY);
+        if (strm == Z_NULL) {
+            fprintf(stderr, "zpoolDeflate error\n");
+            exit(1);
+        }
+        strm->next_in = (z_const unsigned char *)hello;
+        strm->avail_in = (uInt)strlen(hello)+1;
+        strm->next_out = compr;
+        strm->avail_out = (uInt)comprLen;
+        err = deflate(strm, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "pooled deflate should report Z_STREAM_END\n");
+            exit(1);
+        }
+        err = zpoolRelease(pool, strm);
+        CHECK_ERR(err, "zpoolRelease");
+
+        strcpy((char*)uncompr, "garbage");
+        strm = zpoolInflate(pool, MAX_WBITS);
+        if (strm == Z_NULL) {
+            fprintf(stderr, "zpoolInflate error\n");
+            exit(1);
+        }
+        strm->next_in = compr;
+        strm->avail_in = (uInt)comprLen;
+        strm->next_out = uncompr;
+        strm->avail_out = (uInt)uncomprLen;
+        err = inflate(strm, Z_NO_FLUSH);
+        if (err != Z_STREAM_END || strcmp((char*)uncompr, hello)) {
+            fprintf(stderr, "bad pooled inflate\n");
+            exit(1);
+        }
+        err = zpoolRelease(pool, strm);
+        CHECK_ERR(err, "zpoolRelease");
+    }
+
+    /* the first deflate and inflate and the level 1 deflate are misses */
+    err = zpoolStats(pool, &hits, &misses);
+    CHECK_ERR(err, "zpoolStats");
+    if (hits != 5 || misses != 3) {
+        fprintf(stderr, "zpoolStats: %lu hits, %lu misses\n", hits, misses);
+        exit(1);
+    }
+
+    /* a stream released after deflateParams() and deflateSetHeader() must
+       come back as it was made */
+    for (i = 0; i < 2; i++) {
+        strm = zpoolDeflate(pool, 6, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+        if (strm == Z_NULL) {
+            fprintf(stderr, "zpoolDeflate error\n");
+            exit(1);
+        }
+        if (i == 0) {
+            memset(&head, 0, sizeof(head));
+            head.name = (Bytef *)"pooled";
+            err = deflateSetHeader(strm, &head);
+            CHECK_ERR(err, "deflateSetHeader");
+            err = deflateParams(strm, 0, Z_HUFFMAN_ONLY);
+            CHECK_ERR(err, "deflateParams");
+            err = zpoolRelease(pool, strm);
+            CHECK_ERR(err, "zpoolRelease");
+            continue;
+        }
+        strm->next_in = (z_const unsigned char *)hello;
+        strm->avail_in = (uInt)strlen(hello)+1;
+        strm->next_out = compr;
+        strm->avail_out = (uInt)comprLen;
+        err = deflate(strm, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "pooled deflate should report Z_STREAM_END\n");
+            exit(1);
+        }
+        len = comprLen;
+        err = compress2(uncompr, &len, (const Bytef*)hello,
+                        (uLong)strlen(hello)+1, 6);
+        CHECK_ERR(err, "compress2");
+        /* same deflate data as a fresh level 6 stream, and no file name */
+        if (compr[3] != 0 || strm->total_out != len - 6 + 18 ||
+            memcmp(compr + 10, uncompr + 2, (size_t)(len - 6))) {
+            fprintf(stderr, "pooled deflate kept its parameters\n");
+            exit(1);
+        }
+        err = zpoolRelease(pool, strm);
+        CHECK_ERR(err, "zpoolRelease");
+    }
+
+    /* so must streams released after the other settings, part way through */
+    for (i = 0; i < 2; i++) {
+        strm = zpoolDeflate(pool, 6, MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        if (strm == Z_NULL) {
+            fprintf(stderr, "zpoolDeflate error\n");
+            exit(1);
+        }
+        strm->next_out = compr;
+        strm->avail_out = (uInt)comprLen;
+        if (i == 0) {
+            err = deflateTune(strm, 4, 4, 8, 4);
+            CHECK_ERR(err, "deflateTune");
+            err = deflateSetDictionary(strm, (const Bytef*)dictionary,
+                                       (int)sizeof(dictionary));
+            CHECK_ERR(err, "deflateSetDictionary");
+            err = deflateParams(strm, 1, Z_FILTERED);
+            CHECK_ERR(err, "deflateParams");
+            strm->next_in = (z_const unsigned char *)hello;
+            strm->avail_in = (uInt)strlen(hello);
+            err = deflate(strm, Z_NO_FLUSH);
+            CHECK_ERR(err, "deflate");
+            err = deflatePrime(strm, 3, 5);
+            CHECK_ERR(err, "deflatePrime");
+            err = zpoolRelease(pool, strm);
+            CHECK_ERR(err, "zpoolRelease");
+            continue;
+        }
+        for (j = 0; j < uncomprLen; j++)
+            uncompr[j] = (Byte)hello[(j * j) % 13] + (Byte)(j % 3);
+        strm->next_in = uncompr;
+        strm->avail_in = (uInt)uncomprLen;
+        err = deflate(strm, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "pooled deflate should report Z_STREAM_END\n");
+            exit(1);
+        }
+        len = strm->total_out;
+        err = zpoolRelease(pool, strm);
+        CHECK_ERR(err, "zpoolRelease");
+    }
+    j = comprLen - len;
+    err = compress2(compr + len, &j, uncompr, uncomprLen, 6);
+    CHECK_ERR(err, "compress2");
+    if (j != len || memcmp(compr, compr + len, (size_t)len)) {
+        fprintf(stderr, "pooled deflate kept its settings\n");
+        exit(1);
+    }
+
+    for (i = 0; i < 2; i++) {
+        strm = zpoolInflate(pool, MAX_WBITS);
+        if (strm == Z_NULL) {
+            fprintf(stderr, "zpoolInflate error\n");
+            exit(1);
+        }
+        strm->next_in = compr;
+        if (i == 0) {
+            err = inflateContiguous(strm, 1);
+            CHECK_ERR(err, "inflateContiguous");
+            (void)inflateUndermine(strm, 1);
+            strm->avail_in = (uInt)len / 2;
+            strm->next_out = uncompr + uncomprLen / 2;
+            strm->avail_out = (uInt)(uncomprLen - uncomprLen / 2);
+            err = inflate(strm, Z_NO_FLUSH);
+            CHECK_ERR(err, "inflate");
+            err = zpoolRelease(pool, strm);
+            CHECK_ERR(err, "zpoolRelease");
+            continue;
+        }
+
+        /* without contiguous output, inflate can reuse a small buffer */
+        j = 0;
+        do {
+            strm->avail_in = len - strm->total_in < 64 ?
+                             (uInt)(len - strm->total_in) : 64;
+            strm->next_out = out;
+            strm->avail_out = sizeof(out);
+            err = inflate(strm, Z_NO_FLUSH);
+            if (err != Z_STREAM_END)
+                CHECK_ERR(err, "pooled inflate");
+            while (j < strm->total_out &&
+                   out[sizeof(out) - strm->avail_out -
+                       (strm->total_out - j)] ==
+                       (Byte)hello[(j * j) % 13] + (Byte)(j % 3))
+                j++;
+            if (j != strm->total_out) {
+                fprintf(stderr, "pooled inflate kept its settings\n");
+                exit(1);
+            }
+        } while (err != Z_STREAM_END);
+        if (j != uncomprLen) {
+            fprintf(stderr, "pooled inflate kept its settings\n");
+            exit(1);
+        }
+        err = zpoolRelease(pool, strm);
+        CHECK_ERR(err, "zpoolRelease");
+    }
+    err = zpoolClose(pool);
+    CHECK_ERR(err, "zpoolClose");
+    printf("zpool: %lu hits, %lu misses\n", hits, misses);
+}
+
 #endif /* Z_SOLO */
 
 /* ===========================================================================
@@ -538,62 +1137,1168 @@ void test_dict_inflate(compr, comprLen, uncompr, uncomprLen)
     }
 }
 
+/* ===========================================================================
+ * Test that crc32() and adler32() over a large buffer match a byte at a time
+ * update
+ */
+void test_checksums(buf, len)
+    Byte *buf;
+    uLong len;
+{
+    uLong i, n, crc, check, adler, adler_check;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (Byte)((i * 2654435761UL) >> 13);
+
+    /* vary the alignment and length so that every code path is covered */
+    for (i = 0; i < 16; i++) {
+        crc = crc32(0L, buf + i, (uInt)(len - i));
+        adler = adler32(1L, buf + i, (uInt)(len - i));
+        check = 0L;
+        adler_check = 1L;
+        for (n = i; n < len; n++) {
+            check = crc32(check, buf + n, 1);
+            adler_check = adler32(adler_check, buf + n, 1);
+        }
+        if (crc != check) {
+            fprintf(stderr, "bad crc32 at offset %lu\n", i);
+            exit(1);
+        }
+        if (adler != adler_check) {
+            fprintf(stderr, "bad adler32 at offset %lu\n", i);
+            exit(1);
+        }
+    }
+    printf("crc32(): %lx, adler32(): %lx\n", crc, adler);
+}
+
 /* ===========================================================================
  * Usage:  example [output.gz  [input.gz]]
  */
 
-int main(argc, argv)
-    int argc;
-    char *argv[];
-{
+/* ===========================================================================
+ * Test deflate() and inflate() with memory from a caller-provided block,
+ * reusing the block for the inflate stream
+ */
+void test_arena(compr, comprLen, uncompr, uncomprLen)
     Byte *compr, *uncompr;
-    uLong comprLen = 10000*sizeof(int); /* don't overflow on MSDOS */
-    uLong uncomprLen = comprLen;
-    static const char* myVersion = ZLIB_VERSION;
-
-    if (zlibVersion()[0] != myVersion[0]) {
-        fprintf(stderr, "incompatible zlib version\n");
+    uLong comprLen, uncomprLen;
+{
+    int err;
+    uLong size, isize;
+    voidpf mem;
+    z_stream stream, copy;
+
+    size = deflateStateSize(MAX_WBITS, 8);
+    isize = inflateStateSize(MAX_WBITS);
+    if (size == 0 || isize == 0 || deflateStateSize(7, 8) != 0) {
+        fprintf(stderr, "bad deflateStateSize or inflateStateSize\n");
         exit(1);
-
-    } else if (strcmp(zlibVersion(), ZLIB_VERSION) != 0) {
-        fprintf(stderr, "warning: different zlib version\n");
     }
-
-    printf("zlib version %s = 0x%04x, compile flags = 0x%lx\n",
-            ZLIB_VERSION, ZLIB_VERNUM, zlibCompileFlags());
-
-    compr    = (Byte*)calloc((uInt)comprLen, 1);
-    uncompr  = (Byte*)calloc((uInt)uncomprLen, 1);
-    /* compr and uncompr are cleared to avoid reading uninitialized
-     * data and to ensure that uncompr compresses well.
-     */
-    if (compr == Z_NULL || uncompr == Z_NULL) {
+    if (isize > size)
+        size = isize;
+    mem = calloc((uInt)size, 1);
+    if (mem == Z_NULL) {
         printf("out of memory\n");
         exit(1);
     }
 
-#ifdef Z_SOLO
-    argc = strlen(argv[0]);
-#else
-    test_compress(compr, comprLen, uncompr, uncomprLen);
-
-    test_gzio((argc > 1 ? argv[1] : TESTFILE),
-              uncompr, uncomprLen);
-#endif
+    err = deflateInitArena(&stream, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY, mem, size - 1);
+    if (err != Z_MEM_ERROR) {
+        fprintf(stderr, "deflateInitArena should report Z_MEM_ERROR\n");
+        exit(1);
+    }
+    err = deflateInitArena(&stream, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS, 8,
+                           Z_OPTIMAL, mem, size);
+    if (err != Z_STREAM_ERROR) {
+        fprintf(stderr, "deflateInitArena should reject Z_OPTIMAL\n");
+        exit(1);
+    }
+    err = deflateInitArena(&stream, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY, mem, size);
+    CHECK_ERR(err, "deflateInitArena");
+    if (deflateParams(&stream, Z_BEST_SPEED, Z_OPTIMAL) != Z_STREAM_ERROR) {
+        fprintf(stderr, "deflateParams in arena should reject Z_OPTIMAL\n");
+        exit(1);
+    }
+    if (deflateCopy(&copy, &stream) != Z_STREAM_ERROR) {
+        fprintf(stderr, "deflateCopy should reject an arena stream\n");
+        exit(1);
+    }
+    stream.next_in = (z_const unsigned char *)hello;
+    stream.avail_in = (uInt)strlen(hello)+1;
+    stream.next_out = compr;
+    stream.avail_out = (uInt)comprLen;
+    err = deflate(&stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate in arena should report Z_STREAM_END\n");
+        exit(1);
+    }
+    comprLen = stream.total_out;
+    err = deflateEnd(&stream);
+    CHECK_ERR(err, "deflateEnd");
 
-    test_deflate(compr, comprLen);
-    test_inflate(compr, comprLen, uncompr, uncomprLen);
+    strcpy((char*)uncompr, "garbage");
+    stream.next_in = compr;
+    stream.avail_in = (uInt)comprLen;
+    err = inflateInitArena(&stream, MAX_WBITS, mem, isize);
+    CHECK_ERR(err, "inflateInitArena");
+    if (inflateCopy(&copy, &stream) != Z_STREAM_ERROR) {
+        fprintf(stderr, "inflateCopy should reject an arena stream\n");
+        exit(1);
+    }
+    stream.next_out = uncompr;
+    stream.avail_out = (uInt)uncomprLen;
+    err = inflate(&stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "inflate in arena should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = inflateEnd(&stream);
+    CHECK_ERR(err, "inflateEnd");
+    free(mem);
 
-    test_large_deflate(compr, comprLen, uncompr, uncomprLen);
-    test_large_inflate(compr, comprLen, uncompr, uncomprLen);
+    if (strcmp((char*)uncompr, hello)) {
+        fprintf(stderr, "bad inflate in arena\n");
+        exit(1);
+    } else {
+        printf("inflate in arena: %s\n", (char *)uncompr);
+    }
+}
 
-    test_flush(compr, &comprLen);
-    test_sync(compr, comprLen, uncompr, uncomprLen);
+/* ===========================================================================
+ * Test that deflate() with memory sized to all of the input at once gives
+ * the same result as deflate() with full size memory, on the same stream
+ * after deflateReset()
+ */
+void test_sized_deflate(compr, comprLen)
+    Byte *compr;
+    uLong comprLen;
+{
+    z_stream c_stream; /* compression stream */
+    int err;
+    uLong len = (uLong)strlen(hello)+1;
+    uLong half = comprLen >> 1;
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit(&c_stream, Z_BEST_COMPRESSION);
+    CHECK_ERR(err, "deflateInit");
+
+    c_stream.next_in  = (z_const unsigned char *)hello;
+    c_stream.avail_in = (uInt)len;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)half;
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    len = c_stream.total_out;
+
+    err = deflateReset(&c_stream);
+    CHECK_ERR(err, "deflateReset");
+    c_stream.next_in  = (z_const unsigned char *)hello;
+    c_stream.avail_in = (uInt)strlen(hello)+1;
+    c_stream.next_out = compr + half;
+    c_stream.avail_out = (uInt)half;
+    err = deflate(&c_stream, Z_NO_FLUSH);
+    CHECK_ERR(err, "deflate");
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+
+    if (c_stream.total_out != len || memcmp(compr, compr + half, (size_t)len)) {
+        fprintf(stderr, "sized deflate differs from full size deflate\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+    printf("sized deflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test deflate() with a gzip header larger than the pending buffer, which is
+ * small for a short input, written out a little at a time
+ */
+void test_header_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+    gz_header head, got;
+    uInt i, n = (uInt)(uncomprLen / 5 * 2);     /* extra field length */
+    Byte *extra = uncompr, *out = uncompr + 2 * n;
+    int err;
+
+    for (i = 0; i < n; i++)
+        extra[i] = (Byte)(i * 7);
+    memset(&head, 0, sizeof(head));
+    head.extra = extra;
+    head.extra_len = n;
+    head.name = (Bytef *)"name";
+    head.comment = (Bytef *)"comment";
+    head.hcrc = 1;
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+    CHECK_ERR(err, "deflateInit2");
+    err = deflateSetHeader(&c_stream, &head);
+    CHECK_ERR(err, "deflateSetHeader");
+    c_stream.next_in  = (z_const unsigned char *)hello;
+    c_stream.avail_in = (uInt)strlen(hello)+1;
+    c_stream.next_out = compr;
+    do {
+        c_stream.avail_out = 700;
+        err = deflate(&c_stream, Z_FINISH);
+    } while (err == Z_OK && c_stream.total_out + 700 <= comprLen);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+    d_stream.next_in  = compr;
+    d_stream.avail_in = (uInt)c_stream.total_out;
+
+    err = inflateInit2(&d_stream, MAX_WBITS + 16);
+    CHECK_ERR(err, "inflateInit2");
+    memset(&got, 0, sizeof(got));
+    got.extra = extra + n;
+    got.extra_max = n;
+    got.name = out + 1000;
+    got.name_max = 64;
+    got.comm_max = 64;
+    got.comment = out + 1100;
+    err = inflateGetHeader(&d_stream, &got);
+    CHECK_ERR(err, "inflateGetHeader");
+    d_stream.next_out = out;
+    d_stream.avail_out = 1000;
+    err = inflate(&d_stream, Z_FINISH);
+    if (err != Z_STREAM_END || got.done != 1 || got.extra_len != n ||
+        memcmp(extra, extra + n, n) ||
+        strcmp((char *)got.name, "name") ||
+        strcmp((char *)got.comment, "comment") ||
+        strcmp((char *)out, hello)) {
+        fprintf(stderr, "bad deflate header\n");
+        exit(1);
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+    printf("deflate() large header: OK\n");
+}
+
+static unsigned allocs;     /* number of count_alloc() calls */
+
+void *count_alloc OF((void *, unsigned, unsigned));
+void count_free OF((void *, void *));
+
+void *count_alloc(q, n, m)
+    void *q;
+    unsigned n, m;
+{
+    (void)q;
+    allocs++;
+    return calloc(n, m);
+}
+
+void count_free(q, p)
+    void *q, *p;
+{
+    (void)q;
+    free(p);
+}
+
+/* ===========================================================================
+ * Test that a stream reset with deflateReset() for each short message keeps
+ * its memory, and that it still grows for a longer message
+ */
+void test_reset_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    z_stream c_stream; /* compression stream */
+    int err, k;
+    uLong len, first = 0, big = uncomprLen / 2;
+
+    for (len = 0; len < big; len++)
+        uncompr[len] = (Byte)hello[(len * len) % 13] + (Byte)(len % 11);
+
+    c_stream.zalloc = count_alloc;
+    c_stream.zfree = count_free;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit(&c_stream, Z_DEFAULT_COMPRESSION);
+    CHECK_ERR(err, "deflateInit");
+    for (k = 0; k < 12; k++) {
+        if (k) {
+            err = deflateReset(&c_stream);
+            CHECK_ERR(err, "deflateReset");
+        }
+        if (k == 1 || k == 9)
+            allocs = 0;     /* count from the second short message on */
+        if (k == 8) {
+            /* a long message needs more memory */
+            c_stream.next_in  = uncompr;
+            c_stream.avail_in = (uInt)big;
+        }
+        else {
+            c_stream.next_in  = (z_const unsigned char *)hello;
+            c_stream.avail_in = (uInt)strlen(hello)+1;
+        }
+        c_stream.next_out = compr;
+        c_stream.avail_out = (uInt)comprLen;
+        err = deflate(&c_stream, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "deflate should report Z_STREAM_END\n");
+            exit(1);
+        }
+        if (k == 8) {
+            len = uncomprLen - big;
+            err = uncompress(uncompr + big, &len, compr, c_stream.total_out);
+            CHECK_ERR(err, "uncompress");
+            if (len != big || memcmp(uncompr, uncompr + big, (size_t)big)) {
+                fprintf(stderr, "bad deflate after deflateReset\n");
+                exit(1);
+            }
+        }
+        else if (k == 0)
+            first = c_stream.total_out;
+        else if (c_stream.total_out != first || (k == 7 && allocs != 0)) {
+            fprintf(stderr, "deflate after deflateReset: %u allocations\n",
+                    allocs);
+            exit(1);
+        }
+    }
+    if (allocs != 0) {
+        fprintf(stderr, "deflate after deflateReset: %u allocations\n",
+                allocs);
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+    printf("deflateReset() keeps memory: OK\n");
+}
+
+/* ===========================================================================
+ * Test inflate() without a window into contiguous output, given a little at
+ * a time so that matches reach back into the output of earlier calls
+ */
+void test_contig_inflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err;
+    uLong i, len;
+    uInt dictLen;
+    Byte out[100];
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+
+    for (i = 0; i < uncomprLen; i++)
+        uncompr[i] = (Byte)((i % 1000) * (i % 1000) >> 3);
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit(&c_stream, Z_DEFAULT_COMPRESSION);
+    CHECK_ERR(err, "deflateInit");
+    c_stream.next_in  = uncompr;
+    c_stream.avail_in = (uInt)uncomprLen;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    len = c_stream.total_out;
+
+    memset(uncompr, 0, (size_t)uncomprLen);
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+    d_stream.next_in  = compr;
+    d_stream.avail_in = 0;
+    d_stream.next_out = uncompr;
+
+    err = inflateInit(&d_stream);
+    CHECK_ERR(err, "inflateInit");
+    err = inflateContiguous(&d_stream, 1);
+    CHECK_ERR(err, "inflateContiguous");
+
+    do {
+        d_stream.avail_in = len - d_stream.total_in < 64 ?
+                            (uInt)(len - d_stream.total_in) : 64;
+        d_stream.avail_out = uncomprLen - d_stream.total_out < 100 ?
+                             (uInt)(uncomprLen - d_stream.total_out) : 100;
+        err = inflate(&d_stream, Z_NO_FLUSH);
+        if (err == Z_STREAM_END) break;
+        CHECK_ERR(err, "contiguous inflate");
+    } while (d_stream.total_out < uncomprLen);
+
+    for (i = 0; i < uncomprLen; i++)
+        if (uncompr[i] != (Byte)((i % 1000) * (i % 1000) >> 3))
+            break;
+    if (err != Z_STREAM_END || d_stream.total_out != uncomprLen ||
+        i != uncomprLen) {
+        fprintf(stderr, "bad contiguous inflate\n");
+        exit(1);
+    }
+
+    err = inflateGetDictionary(&d_stream, compr, &dictLen);
+    CHECK_ERR(err, "inflateGetDictionary");
+    if (dictLen != 32768 || uncomprLen < dictLen ||
+        memcmp(compr, uncompr + uncomprLen - dictLen, dictLen)) {
+        fprintf(stderr, "bad contiguous inflateGetDictionary\n");
+        exit(1);
+    }
+
+    /* compress again, since compr was used for the dictionary */
+    err = deflateReset(&c_stream);
+    CHECK_ERR(err, "deflateReset");
+    c_stream.next_in  = uncompr;
+    c_stream.avail_in = (uInt)uncomprLen;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END || c_stream.total_out != len) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    /* inflateReset() ends contiguous output, so the output can go to a
+       small buffer that is reused for every call */
+    err = inflateReset(&d_stream);
+    CHECK_ERR(err, "inflateReset");
+    d_stream.next_in  = compr;
+    i = 0;
+    do {
+        d_stream.avail_in = len - d_stream.total_in < 64 ?
+                            (uInt)(len - d_stream.total_in) : 64;
+        d_stream.next_out = out;
+        d_stream.avail_out = sizeof(out);
+        err = inflate(&d_stream, Z_NO_FLUSH);
+        if (err != Z_STREAM_END)
+            CHECK_ERR(err, "inflate after reset");
+        while (i < d_stream.total_out &&
+               out[sizeof(out) - d_stream.avail_out -
+                   (d_stream.total_out - i)] ==
+                   (Byte)((i % 1000) * (i % 1000) >> 3))
+            i++;
+        if (i != d_stream.total_out) {
+            fprintf(stderr, "bad inflate after contiguous reset\n");
+            exit(1);
+        }
+    } while (err != Z_STREAM_END);
+    if (d_stream.total_out != uncomprLen) {
+        fprintf(stderr, "bad inflate after contiguous reset\n");
+        exit(1);
+    }
+
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+    printf("contiguous inflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test inflate() on a series of sync-flushed dynamic blocks with the same
+ * code lengths, whose tables are kept from one block to the next, broken by
+ * blocks whose lengths differ slightly.  A copy made with inflateCopy() in
+ * the middle must use its own kept tables: the original ends with a block
+ * that rebuilds its tables before the copy goes on.
+ */
+void test_kept_inflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    static const char kind[] = "AAAABAAB";  /* B has one byte changed */
+    int err, k;
+    uLong i, at, chunk = 1500, len = (sizeof(kind) - 1) * chunk;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+    z_stream copy;     /* copy of d_stream from the middle of a block */
+
+    if (3 * len > uncomprLen) {
+        fprintf(stderr, "uncompr too small for kept tables\n");
+        exit(1);
+    }
+    for (k = 0; kind[k]; k++)
+        for (i = 0; i < chunk; i++) {
+            uncompr[k * chunk + i] = (Byte)hello[(i / 4 * (i / 4)) % 13];
+            if (kind[k] == 'B' && i == chunk / 2)
+                uncompr[k * chunk + i] = 'Z';
+        }
+
+    /* Z_RLE matches only the last byte, so each chunk after the first is
+       coded the same way as the others of its kind */
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15, 8,
+                       Z_RLE);
+    CHECK_ERR(err, "deflateInit2");
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    for (k = 0; kind[k]; k++) {
+        c_stream.next_in = uncompr + k * chunk;
+        c_stream.avail_in = (uInt)chunk;
+        err = deflate(&c_stream, kind[k + 1] ? Z_SYNC_FLUSH : Z_FINISH);
+        if (err != (kind[k + 1] ? Z_OK : Z_STREAM_END)) {
+            fprintf(stderr, "deflate of kept blocks failed\n");
+            exit(1);
+        }
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    /* inflate a little at a time up to the middle of the third block, by
+       which time the tables of the second are kept for the third */
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+
+    d_stream.next_in  = compr;
+    d_stream.avail_in = 0;
+    err = inflateInit(&d_stream);
+    CHECK_ERR(err, "inflateInit");
+    d_stream.next_out = uncompr + len;
+    d_stream.avail_out = (uInt)len;
+    while (d_stream.total_out < 2 * chunk + chunk / 2) {
+        d_stream.avail_in = 50;
+        err = inflate(&d_stream, Z_NO_FLUSH);
+        CHECK_ERR(err, "inflate");
+    }
+    err = inflateCopy(&copy, &d_stream);
+    CHECK_ERR(err, "inflateCopy");
+
+    /* finish the original, ending on a B block */
+    d_stream.avail_in = (uInt)(c_stream.total_out - d_stream.total_in);
+    err = inflate(&d_stream, Z_NO_FLUSH);
+    if (err != Z_STREAM_END || d_stream.total_out != len ||
+        memcmp(uncompr, uncompr + len, (size_t)len)) {
+        fprintf(stderr, "bad inflate of kept blocks\n");
+        exit(1);
+    }
+
+    /* then the copy, into its own output */
+    at = copy.total_out;
+    copy.next_out = uncompr + 2 * len + at;
+    copy.avail_out = (uInt)(len - at);
+    copy.avail_in = (uInt)(c_stream.total_out - copy.total_in);
+    err = inflate(&copy, Z_NO_FLUSH);
+    if (err != Z_STREAM_END || copy.total_out != len ||
+        memcmp(uncompr + at, uncompr + 2 * len + at, (size_t)(len - at))) {
+        fprintf(stderr, "bad inflate of kept blocks after inflateCopy\n");
+        exit(1);
+    }
+
+    err = inflateEnd(&copy);
+    CHECK_ERR(err, "inflateEnd");
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+    printf("inflate() with kept tables: OK\n");
+}
+
+/* ===========================================================================
+ * Test that inflate() leaves the output buffer past the output it provides
+ * unchanged, with literals and matches of all lengths ending anywhere
+ */
+void test_tail_inflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err;
+    uLong i, n, len = uncomprLen / 2, rand = 1;
+    uInt have;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+
+    /* random letters and copies of earlier strings at distances that
+       inflate_fast() copies in words */
+    for (i = 0; i < len; ) {
+        rand = (rand * 1103515245UL + 12345) & 0xffffffffUL;
+        n = 3 + (rand >> 16) % 60;
+        if (i < 2000 || (rand >> 10) % 3 == 0 || i + n > len)
+            uncompr[i++] = (Byte)('a' + (rand >> 24) % 26);
+        else
+            for (n += i, rand = 32 + (rand >> 4) % 1969; i < n; i++)
+                uncompr[i] = uncompr[i - rand];
+    }
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit(&c_stream, Z_DEFAULT_COMPRESSION);
+    CHECK_ERR(err, "deflateInit");
+    c_stream.next_in = uncompr;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    for (n = 0; c_stream.total_in < len; n++) {
+        c_stream.avail_in = 200 + (uInt)(n * 311 % 900);
+        if (c_stream.avail_in >= len - c_stream.total_in)
+            c_stream.avail_in = (uInt)(len - c_stream.total_in);
+        err = deflate(&c_stream, c_stream.total_in + c_stream.avail_in < len ?
+                                 Z_SYNC_FLUSH : Z_FINISH);
+        if (err != Z_OK && err != Z_STREAM_END) {
+            fprintf(stderr, "deflate error: %d\n", err);
+            exit(1);
+        }
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    /* inflate with Z_BLOCK into an output buffer filled with 0xff, so that
+       inflate() returns with room left right after the last match or literal
+       of each block */
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+
+    d_stream.next_in  = compr;
+    d_stream.avail_in = (uInt)c_stream.total_out;
+    err = inflateInit(&d_stream);
+    CHECK_ERR(err, "inflateInit");
+    memset(uncompr + len, 0xff, (size_t)len);
+    d_stream.next_out = uncompr + len;
+    d_stream.avail_out = (uInt)len;
+    do {
+        err = inflate(&d_stream, Z_BLOCK);
+        if (err != Z_OK && err != Z_STREAM_END) {
+            fprintf(stderr, "inflate error: %d\n", err);
+            exit(1);
+        }
+        for (have = 0; have < d_stream.avail_out; have++)
+            if (d_stream.next_out[have] != 0xff) {
+                fprintf(stderr, "inflate wrote past its output\n");
+                exit(1);
+            }
+    } while (err != Z_STREAM_END);
+    if (d_stream.total_out != len || memcmp(uncompr, uncompr + len, len)) {
+        fprintf(stderr, "bad inflate of tail test\n");
+        exit(1);
+    }
+
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+    printf("inflate() output tail: OK\n");
+}
+
+/* ===========================================================================
+ * Test deflate() with the Z_QUICK strategy, switching to and from it in the
+ * middle of the stream
+ */
+void test_quick_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err, k;
+    uLong i, len = uncomprLen / 4;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+
+    for (i = 0; i < len; i++)
+        uncompr[i] = (Byte)hello[(i * i) % 13] + (Byte)(i % 7);
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_BEST_SPEED, Z_DEFLATED, 15, 8, Z_QUICK);
+    CHECK_ERR(err, "deflateInit2");
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    for (k = 0; k < 3; k++) {
+        c_stream.next_in  = uncompr;
+        c_stream.avail_in = (uInt)len;
+        err = deflate(&c_stream, Z_NO_FLUSH);
+        CHECK_ERR(err, "deflate");
+        err = deflateParams(&c_stream, Z_DEFAULT_COMPRESSION,
+                            k ? Z_DEFAULT_STRATEGY : Z_QUICK);
+        CHECK_ERR(err, "deflateParams");
+    }
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+    d_stream.next_in  = compr;
+    d_stream.avail_in = (uInt)c_stream.total_out;
+
+    err = inflateInit(&d_stream);
+    CHECK_ERR(err, "inflateInit");
+    for (k = 0; k < 3; k++) {
+        d_stream.next_out = uncompr + len;
+        d_stream.avail_out = (uInt)len;
+        err = inflate(&d_stream, Z_NO_FLUSH);
+        if (err != (k == 2 ? Z_STREAM_END : Z_OK) || d_stream.avail_out ||
+            memcmp(uncompr, uncompr + len, (size_t)len)) {
+            fprintf(stderr, "bad quick deflate\n");
+            exit(1);
+        }
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+    printf("quick deflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test deflate() with the Z_OPTIMAL strategy, with the input in small pieces,
+ * and check that it compresses no worse than level 9
+ */
+void test_optimal_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err;
+    uLong i, len = uncomprLen / 2, best = comprLen, rand = 1;
+    z_stream c_stream; /* compression stream */
+
+    for (i = 0; i < len; i++) {
+        rand = (rand * 1103515245UL + 12345) & 0xffffffffUL;
+        uncompr[i] = (Byte)hello[(i * i) % 13] + (Byte)(rand >> 30);
+    }
+
+    err = compress2(compr, &best, uncompr, len, Z_BEST_COMPRESSION);
+    CHECK_ERR(err, "compress2");
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15, 8,
+                       Z_OPTIMAL);
+    CHECK_ERR(err, "deflateInit2");
+    c_stream.next_in  = uncompr;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    for (i = 0; i < len; i += 1000) {
+        c_stream.avail_in = (uInt)(len - i < 1000 ? len - i : 1000);
+        err = deflate(&c_stream, Z_NO_FLUSH);
+        CHECK_ERR(err, "deflate");
+    }
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+#ifndef FASTEST     /* FASTEST compresses both at level 1 */
+    if (c_stream.total_out > best) {
+        fprintf(stderr, "optimal deflate larger than level 9: %lu > %lu\n",
+                c_stream.total_out, best);
+        exit(1);
+    }
+#endif
+
+    i = uncomprLen - len;
+    err = uncompress(uncompr + len, &i, compr, c_stream.total_out);
+    CHECK_ERR(err, "uncompress");
+    if (i != len || memcmp(uncompr, uncompr + len, (size_t)len)) {
+        fprintf(stderr, "bad optimal deflate\n");
+        exit(1);
+    }
+    printf("optimal deflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test deflate() at level 9 with Z_MATCH_TREE, which searches binary trees,
+ * with flushes that leave short strings in the trees, switching to and from
+ * level 6, which searches hash chains, in the middle of the stream
+ */
+void test_tree_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err, k = 0;
+    uLong i, len = uncomprLen / 2;
+    z_stream c_stream; /* compression stream */
+
+    for (i = 0; i < len; i++)
+        uncompr[i] = (Byte)hello[(i * i) % 13] + (Byte)((i * i / 97) % 3);
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15, 8,
+                       Z_DEFAULT_STRATEGY | Z_MATCH_TREE);
+    CHECK_ERR(err, "deflateInit2");
+    if (deflateParams(&c_stream, 9, Z_MATCH_TREE) != Z_STREAM_ERROR) {
+        fprintf(stderr, "deflateParams should reject Z_MATCH_TREE\n");
+        exit(1);
+    }
+    c_stream.next_in  = uncompr;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    for (i = 0; i < len; i += 300) {
+        c_stream.avail_in = (uInt)(len - i < 300 ? len - i : 300);
+        err = deflate(&c_stream, Z_SYNC_FLUSH);
+        CHECK_ERR(err, "deflate");
+        if (++k % 10 == 0) {
+            err = deflateParams(&c_stream, k % 20 ? Z_DEFAULT_COMPRESSION :
+                                Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY);
+            CHECK_ERR(err, "deflateParams");
+        }
+    }
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    i = uncomprLen - len;
+    err = uncompress(uncompr + len, &i, compr, c_stream.total_out);
+    CHECK_ERR(err, "uncompress");
+    if (i != len || memcmp(uncompr, uncompr + len, (size_t)len)) {
+        fprintf(stderr, "bad tree deflate\n");
+        exit(1);
+    }
+    printf("tree deflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test that deflate() ends a block when the statistics of the data change,
+ * here from text to random bytes, though all of the symbols would fit in
+ * one block, and that the output still fits in deflateBound(), also at
+ * level 0 where the Huffman-only and run-length strategies store the data
+ */
+void test_split_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    static int level[3] = {Z_DEFAULT_COMPRESSION, 0, 0};
+    static int strategy[3] = {Z_DEFAULT_STRATEGY, Z_HUFFMAN_ONLY, Z_RLE};
+    int err, k, blocks;
+    uLong i, len = uncomprLen / 2, rand = 1;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+
+    for (k = 0; k < 3; k++) {
+        for (i = 0; i < len; i++) {
+            rand = (rand * 1103515245UL + 12345) & 0xffffffffUL;
+            uncompr[i] = i < len / 2 ? (Byte)hello[(rand >> 24) % 13] :
+                                       (Byte)(rand >> 24);
+        }
+
+        c_stream.zalloc = zalloc;
+        c_stream.zfree = zfree;
+        c_stream.opaque = (voidpf)0;
+
+        err = deflateInit2(&c_stream, level[k], Z_DEFLATED, 15, 8,
+                           strategy[k]);
+        CHECK_ERR(err, "deflateInit2");
+        c_stream.next_in  = uncompr;
+        c_stream.avail_in = (uInt)len;
+        c_stream.next_out = compr;
+        c_stream.avail_out = (uInt)deflateBound(&c_stream, len);
+        if (c_stream.avail_out > comprLen) c_stream.avail_out = (uInt)comprLen;
+        err = deflate(&c_stream, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "deflate should report Z_STREAM_END\n");
+            exit(1);
+        }
+        err = deflateEnd(&c_stream);
+        CHECK_ERR(err, "deflateEnd");
+
+        d_stream.zalloc = zalloc;
+        d_stream.zfree = zfree;
+        d_stream.opaque = (voidpf)0;
+
+        d_stream.next_in  = compr;
+        d_stream.avail_in = (uInt)c_stream.total_out;
+        err = inflateInit(&d_stream);
+        CHECK_ERR(err, "inflateInit");
+        d_stream.next_out = uncompr + len;
+        d_stream.avail_out = (uInt)(uncomprLen - len);
+        blocks = 0;
+        do {
+            err = inflate(&d_stream, Z_BLOCK);
+            if (err == Z_OK && (d_stream.data_type & 128) &&
+                d_stream.total_out)
+                blocks++;       /* stopped at the end of a block */
+        } while (err == Z_OK);
+        CHECK_ERR(err == Z_STREAM_END ? Z_OK : err, "inflate");
+        err = inflateEnd(&d_stream);
+        CHECK_ERR(err, "inflateEnd");
+
+        if (d_stream.total_out != len ||
+            memcmp(uncompr, uncompr + len, (size_t)len)) {
+            fprintf(stderr, "bad split deflate\n");
+            exit(1);
+        }
+        if (k == 0 && blocks < 2) {
+            fprintf(stderr, "split deflate made %d block\n", blocks);
+            exit(1);
+        }
+    }
+    printf("split deflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test deflatePrime() with enough bits to fill the bit buffer, here seven
+ * empty static blocks of ten bits each put in five bits at a time, and
+ * deflatePending() before and after
+ */
+void test_prime(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err, k, bits;
+    unsigned pending;
+    uLong len = (uLong)strlen(hello)+1;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                       Z_DEFAULT_STRATEGY);
+    CHECK_ERR(err, "deflateInit2");
+    for (k = 0; k < 14; k++) {
+        err = deflatePrime(&c_stream, 5, k & 1 ? 0 : 2);
+        CHECK_ERR(err, "deflatePrime");
+    }
+    err = deflatePending(&c_stream, &pending, &bits);
+    CHECK_ERR(err, "deflatePending");
+    if (pending != 8 || bits != 6) {
+        fprintf(stderr, "deflatePending reports %u bytes and %d bits\n",
+                pending, bits);
+        exit(1);
+    }
+
+    c_stream.next_in  = (z_const unsigned char *)hello;
+    c_stream.avail_in = (uInt)len;
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflatePending(&c_stream, &pending, &bits);
+    CHECK_ERR(err, "deflatePending");
+    if (pending != 0 || bits != 0) {
+        fprintf(stderr, "deflatePending reports %u bytes and %d bits\n",
+                pending, bits);
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+
+    d_stream.next_in  = compr;
+    d_stream.avail_in = (uInt)c_stream.total_out;
+    err = inflateInit2(&d_stream, -15);
+    CHECK_ERR(err, "inflateInit2");
+    d_stream.next_out = uncompr;
+    d_stream.avail_out = (uInt)uncomprLen;
+    err = inflate(&d_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "inflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+
+    if (d_stream.total_out != len || strcmp((char*)uncompr, hello)) {
+        fprintf(stderr, "bad deflatePrime\n");
+        exit(1);
+    }
+    printf("deflatePrime(): OK\n");
+}
+
+/* ===========================================================================
+ * Test deflate() with the Z_HASH_CRC flag, at levels using the hash chains
+ * and the binary trees, and that deflateParams() does not take the flag
+ */
+void test_crc_deflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    int err, k;
+    uLong i, len = uncomprLen / 4;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+
+    for (i = 0; i < len; i++)
+        uncompr[i] = (Byte)hello[(i * i) % 13] + (Byte)(i % 5);
+
+    c_stream.zalloc = zalloc;
+    c_stream.zfree = zfree;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_BEST_SPEED, Z_DEFLATED, 15, 8,
+                       Z_DEFAULT_STRATEGY | Z_HASH_CRC | Z_MATCH_TREE);
+    CHECK_ERR(err, "deflateInit2");
+    if (deflateParams(&c_stream, 6, Z_HASH_CRC) != Z_STREAM_ERROR) {
+        fprintf(stderr, "deflateParams should reject Z_HASH_CRC\n");
+        exit(1);
+    }
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    for (k = 0; k < 3; k++) {
+        c_stream.next_in  = uncompr;
+        c_stream.avail_in = (uInt)len;
+        err = deflate(&c_stream, Z_NO_FLUSH);
+        CHECK_ERR(err, "deflate");
+        err = deflateParams(&c_stream, k ? Z_BEST_COMPRESSION : 6,
+                            Z_DEFAULT_STRATEGY);
+        CHECK_ERR(err, "deflateParams");
+    }
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    d_stream.zalloc = zalloc;
+    d_stream.zfree = zfree;
+    d_stream.opaque = (voidpf)0;
+    d_stream.next_in  = compr;
+    d_stream.avail_in = (uInt)c_stream.total_out;
+
+    err = inflateInit(&d_stream);
+    CHECK_ERR(err, "inflateInit");
+    for (k = 0; k < 3; k++) {
+        d_stream.next_out = uncompr + len;
+        d_stream.avail_out = (uInt)len;
+        err = inflate(&d_stream, Z_NO_FLUSH);
+        if (err != (k == 2 ? Z_STREAM_END : Z_OK) || d_stream.avail_out ||
+            memcmp(uncompr, uncompr + len, (size_t)len)) {
+            fprintf(stderr, "bad crc hash deflate\n");
+            exit(1);
+        }
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+    printf("crc hash deflate(): OK\n");
+}
+
+int main(argc, argv)
+    int argc;
+    char *argv[];
+{
+    Byte *compr, *uncompr;
+    uLong comprLen = 10000*sizeof(int); /* don't overflow on MSDOS */
+    uLong uncomprLen = comprLen;
+    static const char* myVersion = ZLIB_VERSION;
+
+    if (zlibVersion()[0] != myVersion[0]) {
+        fprintf(stderr, "incompatible zlib version\n");
+        exit(1);
+
+    } else if (strcmp(zlibVersion(), ZLIB_VERSION) != 0) {
+        fprintf(stderr, "warning: different zlib version\n");
+    }
+
+    printf("zlib version %s = 0x%04x, compile flags = 0x%lx\n",
+            ZLIB_VERSION, ZLIB_VERNUM, zlibCompileFlags());
+
+    compr    = (Byte*)calloc((uInt)comprLen, 1);
+    uncompr  = (Byte*)calloc((uInt)uncomprLen, 1);
+    /* compr and uncompr are cleared to avoid reading uninitialized
+     * data and to ensure that uncompr compresses well.
+     */
+    if (compr == Z_NULL || uncompr == Z_NULL) {
+        printf("out of memory\n");
+        exit(1);
+    }
+
+#ifdef Z_SOLO
+    argc = strlen(argv[0]);
+#else
+    test_compress(compr, comprLen, uncompr, uncomprLen);
+
+    test_gzio((argc > 1 ? argv[1] : TESTFILE),
+              uncompr, uncomprLen);
+
+    test_gzpio((argc > 1 ? argv[1] : TESTFILE),
+               compr, comprLen, uncompr, uncomprLen);
+
+    test_gzindex((argc > 1 ? argv[1] : TESTFILE),
+                 compr, comprLen, uncompr, uncomprLen);
+
+    test_gzspan((argc > 1 ? argv[1] : TESTFILE),
+                compr, comprLen, uncompr, uncomprLen);
+    if (argc < 2)
+        remove(TESTFILE);       /* do not leave the test file behind */
+
+    test_zpool(compr, comprLen, uncompr, uncomprLen);
+#endif
+
+    test_deflate(compr, comprLen);
+    test_inflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_large_deflate(compr, comprLen, uncompr, uncomprLen);
+    test_large_inflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_flush(compr, &comprLen);
+    test_sync(compr, comprLen, uncompr, uncomprLen);
     comprLen = uncomprLen;
 
     test_dict_deflate(compr, comprLen);
     test_dict_inflate(compr, comprLen, uncompr, uncomprLen);
 
+    test_checksums(compr, comprLen);
+
+    test_arena(compr, comprLen, uncompr, uncomprLen);
+
+    test_sized_deflate(compr, comprLen);
+    test_header_deflate(compr, comprLen, uncompr, uncomprLen);
+    test_reset_deflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_contig_inflate(compr, comprLen, uncompr, uncomprLen);
+    test_kept_inflate(compr, comprLen, uncompr, uncomprLen);
+    test_tail_inflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_quick_deflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_optimal_deflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_tree_deflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_split_deflate(compr, comprLen, uncompr, uncomprLen);
+
+    test_prime(compr, comprLen, uncompr, uncomprLen);
+
+    test_crc_deflate(compr, comprLen, uncompr, uncomprLen);
+
     free(compr);
     free(uncompr);
 
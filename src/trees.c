@@ -80,6 +80,22 @@ local const uch bl_order[BL_CODES]
 
 #define DIST_CODE_LEN  512 /* see definition of array dist_code below */
 
+#define SPLIT_SYMS 512
+/* Number of symbols between the checks for the end of a block */
+
+#define SPLIT_TREE 40
+/* Bits of a dynamic tree description besides four bits for each code used */
+
+#define SPLIT_MOST (20 + 3*BL_CODES + MAX_BL_BITS*(L_CODES+D_CODES))
+/* Most bits in the header and end code of a dynamic block */
+
+local const uch split_log[64]
+   = {0,6,11,17,22,28,33,38,44,49,54,59,63,68,73,78,82,87,92,96,100,105,109,
+      113,118,122,126,130,134,138,142,146,150,154,157,161,165,169,172,176,
+      179,183,186,190,193,197,200,203,207,210,213,216,220,223,226,229,232,
+      235,238,241,244,247,250,253};
+/* 256 * log2(1 + n/64), for the symbol cost estimates of _tr_split() */
+
 #if defined(GEN_TREES_H) || !defined(STDC)
 /* non ANSI compilers may not accept trees.h */
 
@@ -137,6 +153,9 @@ local static_tree_desc  static_bl_desc =
 
 local void tr_static_init OF((void));
 local void init_block     OF((deflate_state *s));
+local ulg  split_xlog     OF((unsigned x));
+local unsigned split_tree OF((const ct_data *tree, ush *freq, int elems,
+                              ulg *cost, ulg *part));
 local void pqdownheap     OF((deflate_state *s, ct_data *tree, int k));
 local void gen_bitlen     OF((deflate_state *s, tree_desc *desc));
 local void gen_codes      OF((ct_data *tree, int max_code, ushf *bl_count));
@@ -178,9 +197,34 @@ local void gen_trees_header OF((void));
     put_byte(s, (uch)((ush)(w) >> 8)); \
 }
 
+/* ===========================================================================
+ * Output a full bit buffer LSB first on the stream, with a single store of
+ * eight bytes where the byte order allows it.
+ * IN assertion: there is enough room in pendingBuf.
+ */
+#ifdef BI_WORDS
+#  if (defined(__BYTE_ORDER__) && \
+       __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_WIN64)
+#    define put_bits(s, w) { \
+    zmemcpy(s->pending_buf + s->pending, &(w), 8); \
+    s->pending += 8; \
+}
+#  else
+#    define put_bits(s, w) { \
+    put_short(s, (w)); \
+    put_short(s, ((w) >> 16)); \
+    put_short(s, ((w) >> 32)); \
+    put_short(s, ((w) >> 48)); \
+}
+#  endif
+#else
+#  define put_bits(s, w) put_short(s, w)
+#endif
+
 /* ===========================================================================
  * Send a value on a given number of bits.
- * IN assertion: length <= 16 and value fits in length bits.
+ * IN assertion: length <= 16 and value fits in length bits, except that
+ * with BI_SEND_MATCH length may be up to 48.
  */
 #ifdef DEBUG
 local void send_bits      OF((deflate_state *s, int value, int length));
@@ -195,16 +239,16 @@ local void send_bits(s, value, length)
     s->bits_sent += (ulg)length;
 
     /* If not enough room in bi_buf, use (valid) bits from bi_buf and
-     * (16 - bi_valid) bits from value, leaving (width - (16-bi_valid))
-     * unused bits in value.
+     * (Buf_size - bi_valid) bits from value, leaving (width -
+     * (Buf_size - bi_valid)) unused bits in value.  bi_valid is always
+     * left less than Buf_size, so that the shifts are all in range.
      */
-    if (s->bi_valid > (int)Buf_size - length) {
-        s->bi_buf |= (ush)value << s->bi_valid;
-        put_short(s, s->bi_buf);
-        s->bi_buf = (ush)value >> (Buf_size - s->bi_valid);
+    s->bi_buf |= (bi_word)value << s->bi_valid;
+    if (s->bi_valid + length >= (int)Buf_size) {
+        put_bits(s, s->bi_buf);
+        s->bi_buf = (bi_word)value >> (Buf_size - s->bi_valid);
         s->bi_valid += length - Buf_size;
     } else {
-        s->bi_buf |= (ush)value << s->bi_valid;
         s->bi_valid += length;
     }
 }
@@ -212,19 +256,25 @@ local void send_bits(s, value, length)
 
 #define send_bits(s, value, length) \
 { int len = length;\
-  if (s->bi_valid > (int)Buf_size - len) {\
-    int val = value;\
-    s->bi_buf |= (ush)val << s->bi_valid;\
-    put_short(s, s->bi_buf);\
-    s->bi_buf = (ush)val >> (Buf_size - s->bi_valid);\
+  bi_word val = (bi_word)(value);\
+  s->bi_buf |= val << s->bi_valid;\
+  if (s->bi_valid + len >= (int)Buf_size) {\
+    put_bits(s, s->bi_buf);\
+    s->bi_buf = val >> (Buf_size - s->bi_valid);\
     s->bi_valid += len - Buf_size;\
   } else {\
-    s->bi_buf |= (ush)(value) << s->bi_valid;\
     s->bi_valid += len;\
   }\
 }
 #endif /* DEBUG */
 
+#if defined(BI_WORDS) && !defined(DEBUG)
+#  define BI_SEND_MATCH
+#endif
+/* With the 64-bit bit buffer, compress_block() sends all of the bits of a
+   match with one send_bits() -- not with DEBUG, whose send_bits() takes an
+   int and checks for codes of at most 15 bits */
+
 
 /* the arguments must not have side effects */
 
@@ -419,6 +469,18 @@ local void init_block(s)
     s->dyn_ltree[END_BLOCK].Freq = 1;
     s->opt_len = s->static_len = 0L;
     s->last_lit = s->matches = 0;
+
+    /* Z_FIXED has no trees to adapt, Z_OPTIMAL sizes its own blocks, Z_QUICK
+       trades the better trees for speed, and level 0 emits only stored
+       blocks, which splitting would just add headers to */
+    s->split_at = s->lit_bufsize - 1;
+    if (s->level != 0 && s->strategy != Z_FIXED && s->strategy != Z_OPTIMAL &&
+        s->strategy != Z_QUICK && s->split_at > SPLIT_SYMS) {
+        s->split_at = SPLIT_SYMS;
+        for (n = 0; n < L_CODES + D_CODES; n++) s->split_freq[n] = 0;
+        s->split_freq[END_BLOCK] = 1;
+        s->split_cost = 0;
+    }
 }
 
 #define SMALLEST 1
@@ -1047,11 +1109,185 @@ int ZLIB_INTERNAL _tr_tally (s, dist, lc)
         if (s->matches < s->last_lit/2 && out_length < in_length/2) return 1;
     }
 #endif
-    return (s->last_lit == s->lit_bufsize-1);
+    return s->last_lit == s->split_at && _tr_split(s);
+}
+
+/* ===========================================================================
+ * Return x * log2(x) in 1/256 bits, with log2(x) within 1/32, for x < 64K.
+ */
+local ulg split_xlog(x)
+    unsigned x;
+{
+    unsigned e, n;      /* floor(log2(x)), found without loops */
+    unsigned y;         /* x shifted right, then the top seven bits of x */
+
+    if (x == 0) return 0;
+    e = x >> 8 ? 8 : 0;
+    y = x >> e;
+    n = y >> 4 ? 4 : 0;
+    e += n;
+    y >>= n;
+    n = y >> 2 ? 2 : 0;
+    e += n;
+    y >>= n;
+    e += y >> 1;
+    y = (unsigned)(((ulg)x << 6) >> e);     /* 64..127 */
+    return (ulg)x * ((e << 8) + split_log[y - 64]);
+}
+
+/* ===========================================================================
+ * Add to *cost the estimated bits of the codes of tree as tallied so far, and
+ * to *part those of the codes tallied since the last check, whose
+ * frequencies at that check are in freq[], then update freq[].  The extra
+ * bits are left out, since they are the same however a block is split.
+ * Return the number of codes used since the last check.
+ */
+local unsigned split_tree(tree, freq, elems, cost, part)
+    const ct_data *tree;    /* the tree */
+    ush *freq;              /* frequencies at the last check */
+    int elems;              /* number of codes in the tree */
+    ulg *cost;              /* bits of the codes tallied so far */
+    ulg *part;              /* bits of the codes since the last check */
+{
+    int n;                  /* iterates over the codes */
+    unsigned f, p;          /* frequencies now and at the last check */
+    ulg fsum = 0, psum = 0; /* symbols so far and since the last check */
+    ulg flog = 0, plog = 0; /* sums of x * log2(x) over those frequencies */
+    unsigned used = 0;      /* codes used since the last check */
+
+    for (n = 0; n < elems; n++) {
+        f = tree[n].Freq;
+        if (f == 0)
+            continue;
+        fsum += f;
+        flog += split_xlog(f);
+        p = freq[n];
+        if (f != p) {
+            freq[n] = (ush)f;
+            f -= p;
+            psum += f;
+            plog += split_xlog(f);
+            used++;
+        }
+    }
+    *cost += split_xlog(fsum) - flog;
+    *part += split_xlog(psum) - plog;
+    return used;
+}
+
+/* ===========================================================================
+ * Called when last_lit reaches split_at.  Return true if the current block
+ * must be flushed, either because the literal buffer is full, or because the
+ * symbols tallied since the last check, every SPLIT_SYMS symbols, look to be
+ * worth a new dynamic tree.  That is the case when the entropy of the block
+ * so far is more than the entropies of the part before the last check and
+ * of the part after it, coded separately, plus an estimate of the bits to
+ * describe another tree.  The block cannot be cut at the last check, since
+ * its symbols are already sent to the same trees, so it is ended here and
+ * the next block starts with the new statistics.  This needs no extra pass
+ * over the data, just a look at the frequencies of each code at each check.
+ */
+int ZLIB_INTERNAL _tr_split(s)
+    deflate_state *s;
+{
+    ulg cost = 0;       /* estimated bits of the block so far */
+    ulg part = 0;       /* same for the symbols since the last check */
+    unsigned used;      /* number of codes used since the last check */
+    int split;          /* true to end the block */
+    int n;              /* iterates over the codes */
+    ulg bits;           /* upper bound on the compressed bits of the block */
+
     /* We avoid equality with lit_bufsize because of wraparound at 64K
      * on 16 bit machines and because stored blocks are restricted to
      * 64K-1 bytes.
      */
+    if (s->last_lit >= s->lit_bufsize - 1)
+        return 1;
+
+    /* End the block if splitting it at the last check would have paid for
+       another tree (the first check has no earlier part to compare with). */
+    used = split_tree(s->dyn_ltree, s->split_freq, L_CODES, &cost, &part) +
+           split_tree(s->dyn_dtree, s->split_freq + L_CODES, D_CODES,
+                      &cost, &part);
+    split = s->split_cost != 0 &&
+            s->split_cost + part + ((ulg)(4 * used + SPLIT_TREE) << 8) < cost;
+
+    /* Do not end a block that could come out stored, since short stored
+       blocks would not fit in deflateBound().  The codes take at most a
+       bit more per symbol than the estimate, plus some for rounding. */
+    if (split) {
+        bits = (cost >> 8) + 2 * (ulg)s->last_lit + SPLIT_MOST;
+        for (n = 0; n < LENGTH_CODES; n++)
+            bits += (ulg)s->dyn_ltree[LITERALS+1+n].Freq * extra_lbits[n];
+        for (n = 0; n < D_CODES; n++)
+            bits += (ulg)s->dyn_dtree[n].Freq * extra_dbits[n];
+        split = bits + 8 * 5 < (ulg)((long)s->strstart - s->block_start) << 3;
+    }
+    s->split_cost = cost;
+    s->split_at = s->last_lit + SPLIT_SYMS;
+    if (s->split_at > s->lit_bufsize - 1)
+        s->split_at = s->lit_bufsize - 1;
+    return split;
+}
+
+/* ===========================================================================
+ * Build the dynamic trees for the symbols tallied so far, and set the bit
+ * costs of each literal/length code in lcost[] and each distance code in
+ * dcost[] with those trees, including the extra bits.  Codes that were not
+ * used get one bit more than the longest code in their tree.  Return the bit
+ * length of the tallied symbols, not counting the tree descriptions, and
+ * discard all but the first keep of them.  This lets deflate_optimal() in
+ * deflate.c refine the cost model for its parse of the rest of a block.
+ */
+ulg ZLIB_INTERNAL _tr_costs(s, keep, lcost, dcost)
+    deflate_state *s;
+    unsigned keep;  /* number of tallied symbols to keep */
+    uch *lcost;     /* L_CODES costs of the literal/length codes */
+    uch *dcost;     /* D_CODES costs of the distance codes */
+{
+    ulg bits;       /* bit length of the tallied symbols */
+    int n;          /* iterates over tree elements */
+    int max;        /* longest code in a tree */
+    unsigned lx;    /* running index in l_buf */
+    unsigned dist;  /* distance of matched string */
+    int lc;         /* match length or unmatched char (if dist == 0) */
+
+    build_tree(s, (tree_desc *)(&(s->l_desc)));
+    build_tree(s, (tree_desc *)(&(s->d_desc)));
+    bits = s->opt_len;
+
+    max = 0;
+    for (n = 0; n < L_CODES; n++)
+        if (s->dyn_ltree[n].Len > max) max = s->dyn_ltree[n].Len;
+    for (n = 0; n < L_CODES; n++) {
+        lcost[n] = (uch)(s->dyn_ltree[n].Len ? s->dyn_ltree[n].Len : max + 1);
+        if (n > LITERALS)
+            lcost[n] += (uch)extra_lbits[n - LITERALS - 1];
+    }
+    max = 0;
+    for (n = 0; n < D_CODES; n++)
+        if (s->dyn_dtree[n].Len > max) max = s->dyn_dtree[n].Len;
+    for (n = 0; n < D_CODES; n++) {
+        dcost[n] = (uch)(s->dyn_dtree[n].Len ? s->dyn_dtree[n].Len : max + 1);
+        dcost[n] += (uch)extra_dbits[n];
+    }
+
+    /* tally the kept symbols again */
+    init_block(s);
+    for (lx = 0; lx < keep; lx++) {
+        dist = s->d_buf[lx];
+        lc = s->l_buf[lx];
+        if (dist == 0) {
+            s->dyn_ltree[lc].Freq++;
+        } else {
+            s->matches++;
+            dist--;
+            s->dyn_ltree[_length_code[lc]+LITERALS+1].Freq++;
+            s->dyn_dtree[d_code(dist)].Freq++;
+        }
+    }
+    s->last_lit = keep;
+    return bits;
 }
 
 /* ===========================================================================
@@ -1067,6 +1303,10 @@ local void compress_block(s, ltree, dtree)
     unsigned lx = 0;    /* running index in l_buf */
     unsigned code;      /* the code to send */
     int extra;          /* number of extra bits to send */
+#ifdef BI_SEND_MATCH
+    bi_word word;       /* bits of a match to send */
+    int width;          /* number of bits in word */
+#endif
 
     if (s->last_lit != 0) do {
         dist = s->d_buf[lx];
@@ -1077,6 +1317,24 @@ local void compress_block(s, ltree, dtree)
         } else {
             /* Here, lc is the match length - MIN_MATCH */
             code = _length_code[lc];
+#ifdef BI_SEND_MATCH
+            /* send the length and distance codes and their extra bits, up
+               to 48 bits, all at once */
+            word = ltree[code+LITERALS+1].Code;
+            width = ltree[code+LITERALS+1].Len;
+            extra = extra_lbits[code];
+            if (extra != 0) {   /* base_length[] is 0 for the length 258 */
+                word |= (bi_word)(lc - base_length[code]) << width;
+                width += extra;
+            }
+            dist--;
+            code = d_code(dist);
+            word |= (bi_word)dtree[code].Code << width;
+            width += dtree[code].Len;
+            word |= (bi_word)(dist - base_dist[code]) << width;
+            width += extra_dbits[code];
+            send_bits(s, word, width);
+#else
             send_code(s, code+LITERALS+1, ltree); /* send the length code */
             extra = extra_lbits[code];
             if (extra != 0) {
@@ -1093,6 +1351,7 @@ local void compress_block(s, ltree, dtree)
                 dist -= base_dist[code];
                 send_bits(s, dist, extra);   /* send the extra distance bits */
             }
+#endif
         } /* literal or match pair ? */
 
         /* Check that the overlay between pending_buf and d_buf+l_buf is ok: */
@@ -1169,11 +1428,7 @@ local unsigned bi_reverse(code, len)
 local void bi_flush(s)
     deflate_state *s;
 {
-    if (s->bi_valid == 16) {
-        put_short(s, s->bi_buf);
-        s->bi_buf = 0;
-        s->bi_valid = 0;
-    } else if (s->bi_valid >= 8) {
+    while (s->bi_valid >= 8) {
         put_byte(s, (Byte)s->bi_buf);
         s->bi_buf >>= 8;
         s->bi_valid -= 8;
@@ -1186,10 +1441,10 @@ local void bi_flush(s)
 local void bi_windup(s)
     deflate_state *s;
 {
-    if (s->bi_valid > 8) {
-        put_short(s, s->bi_buf);
-    } else if (s->bi_valid > 0) {
+    while (s->bi_valid > 0) {
         put_byte(s, (Byte)s->bi_buf);
+        s->bi_buf >>= 8;
+        s->bi_valid -= 8;
     }
     s->bi_buf = 0;
     s->bi_valid = 0;
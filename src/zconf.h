@@ -42,6 +42,7 @@
 #  define deflateCopy           z_deflateCopy
 #  define deflateEnd            z_deflateEnd
 #  define deflateInit2_         z_deflateInit2_
+#  define deflateInitArena_     z_deflateInitArena_
 #  define deflateInit_          z_deflateInit_
 #  define deflateParams         z_deflateParams
 #  define deflatePending        z_deflatePending
@@ -50,12 +51,14 @@
 #  define deflateResetKeep      z_deflateResetKeep
 #  define deflateSetDictionary  z_deflateSetDictionary
 #  define deflateSetHeader      z_deflateSetHeader
+#  define deflateStateSize      z_deflateStateSize
 #  define deflateTune           z_deflateTune
 #  define deflate_copyright     z_deflate_copyright
 #  define get_crc_table         z_get_crc_table
 #  ifndef Z_SOLO
 #    define gz_error              z_gz_error
 #    define gz_intmax             z_gz_intmax
+#    define gz_jump               z_gz_jump
 #    define gz_strwinerror        z_gz_strwinerror
 #    define gzbuffer              z_gzbuffer
 #    define gzclearerr            z_gzclearerr
@@ -70,6 +73,12 @@
 #    define gzgetc                z_gzgetc
 #    define gzgetc_               z_gzgetc_
 #    define gzgets                z_gzgets
+#    define gzindex_build         z_gzindex_build
+#    define gzindex_free          z_gzindex_free
+#    define gzindex_load          z_gzindex_load
+#    define gzindex_read          z_gzindex_read
+#    define gzindex_read64        z_gzindex_read64
+#    define gzindex_save          z_gzindex_save
 #    define gzoffset              z_gzoffset
 #    define gzoffset64            z_gzoffset64
 #    define gzopen                z_gzopen
@@ -77,15 +86,21 @@
 #    ifdef _WIN32
 #      define gzopen_w              z_gzopen_w
 #    endif
+#    define gzpbuffer             z_gzpbuffer
+#    define gzpclose              z_gzpclose
+#    define gzpdopen              z_gzpdopen
 #    define gzprintf              z_gzprintf
 #    define gzvprintf             z_gzvprintf
 #    define gzputc                z_gzputc
+#    define gzpuncompress         z_gzpuncompress
 #    define gzputs                z_gzputs
+#    define gzpwrite              z_gzpwrite
 #    define gzread                z_gzread
 #    define gzrewind              z_gzrewind
 #    define gzseek                z_gzseek
 #    define gzseek64              z_gzseek64
 #    define gzsetparams           z_gzsetparams
+#    define gzspan                z_gzspan
 #    define gztell                z_gztell
 #    define gztell64              z_gztell64
 #    define gzungetc              z_gzungetc
@@ -95,16 +110,19 @@
 #  define inflateBack           z_inflateBack
 #  define inflateBackEnd        z_inflateBackEnd
 #  define inflateBackInit_      z_inflateBackInit_
+#  define inflateContiguous     z_inflateContiguous
 #  define inflateCopy           z_inflateCopy
 #  define inflateEnd            z_inflateEnd
 #  define inflateGetHeader      z_inflateGetHeader
 #  define inflateInit2_         z_inflateInit2_
+#  define inflateInitArena_     z_inflateInitArena_
 #  define inflateInit_          z_inflateInit_
 #  define inflateMark           z_inflateMark
 #  define inflatePrime          z_inflatePrime
 #  define inflateReset          z_inflateReset
 #  define inflateReset2         z_inflateReset2
 #  define inflateSetDictionary  z_inflateSetDictionary
+#  define inflateStateSize      z_inflateStateSize
 #  define inflateGetDictionary  z_inflateGetDictionary
 #  define inflateSync           z_inflateSync
 #  define inflateSyncPoint      z_inflateSyncPoint
@@ -112,17 +130,29 @@
 #  define inflateResetKeep      z_inflateResetKeep
 #  define inflate_copyright     z_inflate_copyright
 #  define inflate_fast          z_inflate_fast
+#  define inflate_pairs         z_inflate_pairs
 #  define inflate_table         z_inflate_table
 #  ifndef Z_SOLO
 #    define uncompress            z_uncompress
 #  endif
 #  define zError                z_zError
+#  define zaralloc              z_zaralloc
+#  define zarena                z_zarena
+#  define zarfree               z_zarfree
 #  ifndef Z_SOLO
 #    define zcalloc               z_zcalloc
 #    define zcfree                z_zcfree
 #  endif
 #  define zlibCompileFlags      z_zlibCompileFlags
 #  define zlibVersion           z_zlibVersion
+#  ifndef Z_SOLO
+#    define zpoolClose            z_zpoolClose
+#    define zpoolDeflate          z_zpoolDeflate
+#    define zpoolInflate          z_zpoolInflate
+#    define zpoolOpen             z_zpoolOpen
+#    define zpoolRelease          z_zpoolRelease
+#    define zpoolStats            z_zpoolStats
+#  endif
 
 /* all zlib typedefs in zlib.h and zconf.h */
 #  define Byte                  z_Byte
@@ -132,6 +162,8 @@
 #  define free_func             z_free_func
 #  ifndef Z_SOLO
 #    define gzFile                z_gzFile
+#    define gzIndex               z_gzIndex
+#    define gzpFile               z_gzpFile
 #  endif
 #  define gz_header             z_gz_header
 #  define gz_headerp            z_gz_headerp
@@ -254,6 +286,9 @@
  the default memory requirements from 256K to 128K, compile with
      make CFLAGS="-O -DMAX_WBITS=14 -DMAX_MEM_LEVEL=7"
  Of course this will generally degrade compression (there's no free lunch).
+ Level 9 needs another (1 << (windowBits+1)), 64K, for its binary trees.
+ When all of the input is given to the first deflate() call with Z_FINISH,
+ the window and the memLevel buffer are sized down to the input.
 
    The memory requirements for inflate are (in bytes) 1 << windowBits
  that is, 32K for windowBits=15 (default value) plus a few kilobytes
@@ -193,9 +193,15 @@ typedef gz_header FAR *gz_headerp;
 #define Z_HUFFMAN_ONLY        2
 #define Z_RLE                 3
 #define Z_FIXED               4
+#define Z_QUICK               5
+#define Z_OPTIMAL             6
 #define Z_DEFAULT_STRATEGY    0
 /* compression strategy; see deflateInit2() below for details */
 
+#define Z_HASH_CRC           16
+#define Z_MATCH_TREE         32
+/* flags or'ed with a strategy for deflateInit2() */
+
 #define Z_BINARY   0
 #define Z_TEXT     1
 #define Z_ASCII    Z_TEXT   /* for compatibility with 1.2.2 and earlier */
@@ -343,7 +349,8 @@ ZEXTERN int ZEXPORT deflate OF((z_streamp strm, int flush));
   processed or more output produced), Z_STREAM_END if all input has been
   consumed and all output has been produced (only when flush is set to
   Z_FINISH), Z_STREAM_ERROR if the stream state was inconsistent (for example
-  if next_in or next_out was Z_NULL), Z_BUF_ERROR if no progress is possible
+  if next_in or next_out was Z_NULL), Z_MEM_ERROR if the first call could not
+  allocate the window and buffers, Z_BUF_ERROR if no progress is possible
   (for example avail_in or avail_out was zero).  Note that Z_BUF_ERROR is not
   fatal, and deflate() can be called again with more input and more output
   space to continue compressing.
@@ -407,7 +414,8 @@ ZEXTERN int ZEXPORT inflate OF((z_streamp strm, int flush));
   - Provide more output starting at next_out and update next_out and avail_out
     accordingly.  inflate() provides as much output as possible, until there is
     no more input data or no more space in the output buffer (see below about
-    the flush parameter).
+    the flush parameter).  The avail_out bytes at next_out on return, past the
+    output provided, are left unchanged.
 
     Before the call of inflate(), the application should ensure that at least
   one of the actions is possible, by providing more input and/or consuming more
@@ -574,7 +582,39 @@ ZEXTERN int ZEXPORT deflateInit2 OF((z_streamp strm,
    strategy parameter only affects the compression ratio but not the
    correctness of the compressed output even if it is not set appropriately.
    Z_FIXED prevents the use of dynamic Huffman codes, allowing for a simpler
-   decoder for special applications.
+   decoder for special applications.  Z_QUICK looks for a match only at the
+   last string with the same hash of the next four bytes, which is faster than
+   level 1 (about 1.3 times as fast on mixed text and binary data), usually
+   with some loss of compression.  All levels from 1 to 9 are the same with
+   Z_QUICK, and level 0 still stores the data.
+   Z_OPTIMAL chooses the literals and matches for each block that code to the
+   fewest bits, by repeating a least-cost parse with the bit lengths of the
+   Huffman codes from the parse before.  This compresses a few percent better
+   than level 9, but takes many times as long.  The level sets the effort of
+   the match search as usual, with 9 the slowest and best, and level 0 still
+   stores the data.  Z_OPTIMAL needs about 54 << (memLevel + 6) more bytes of
+   memory (850K for the default memLevel), allocated by the first deflate()
+   call that uses it.  The compressed data can be decompressed by any inflate.
+
+     Z_HASH_CRC can be or'ed with the strategy to hash the four bytes at each
+   string with the processor's CRC-32C instruction instead of the usual
+   rolling hash of three bytes.  This spreads the strings more evenly over the
+   hash table, so that levels 1 through 9 are faster, though matches of length
+   three are no longer found.  The instruction is used only where the processor
+   has it (SSE4.2 on x86, the CRC extension on ARMv8), so that with Z_HASH_CRC
+   the same input and parameters can compress to different (all valid) output
+   on different machines.  Without it, the output does not depend on the
+   machine.  The hash is kept for the life of the stream, and Z_HASH_CRC is not
+   accepted by deflateParams().
+
+     Z_MATCH_TREE can be or'ed with the strategy to have level 9 keep the
+   strings with the same hash in binary trees sorted on their contents instead
+   of in hash chains.  This finds a few more of the longest matches, usually
+   making the output less than 0.1% smaller.  It is faster on some binary
+   data, but slower on most text, and can be many times slower on highly
+   repetitive data.  It applies to the default strategy, Z_FILTERED, and
+   Z_FIXED, and has no effect on the other levels.  Like Z_HASH_CRC, it is
+   kept for the life of the stream and is not accepted by deflateParams().
 
      deflateInit2 returns Z_OK if success, Z_MEM_ERROR if there was not enough
    memory, Z_STREAM_ERROR if any parameter is invalid (such as an invalid
@@ -582,6 +622,15 @@ ZEXTERN int ZEXPORT deflateInit2 OF((z_streamp strm,
    incompatible with the version assumed by the caller (ZLIB_VERSION).  msg is
    set to null if there is no error message.  deflateInit2 does not perform any
    compression: this will be done by deflate().
+
+     deflateInit2 allocates only the internal state.  The window, hash table,
+   and buffers are allocated by the first call of deflate(), or of
+   deflateSetDictionary() or deflatePrime() if those come first.  If that
+   first deflate() call has flush set to Z_FINISH, so that all of the input is
+   present, the window and buffers are made only as large as that input needs.
+   The compressed data is the same as it would be with the full sizes.
+   deflateReset() keeps the buffers.  They are allocated again, larger, only
+   if a later input needs more than they have.
 */
 
 ZEXTERN int ZEXPORT deflateSetDictionary OF((z_streamp strm,
@@ -739,7 +788,7 @@ ZEXTERN int ZEXPORT deflatePrime OF((z_streamp strm,
 
      deflatePrime returns Z_OK if success, Z_BUF_ERROR if there was not enough
    room in the internal buffer to insert the bits, or Z_STREAM_ERROR if the
-   source stream state was inconsistent.
+   source stream state was inconsistent or bits was out of range.
 */
 
 ZEXTERN int ZEXPORT deflateSetHeader OF((z_streamp strm,
@@ -766,6 +815,37 @@ ZEXTERN int ZEXPORT deflateSetHeader OF((z_streamp strm,
    stream state was inconsistent.
 */
 
+ZEXTERN uLong ZEXPORT deflateStateSize OF((int windowBits, int memLevel));
+/*
+ZEXTERN int ZEXPORT deflateInitArena OF((z_streamp strm, int level,
+                                         int method, int windowBits,
+                                         int memLevel, int strategy,
+                                         voidpf mem, uLong size));
+
+     deflateInitArena() is the same as deflateInit2(), except that all of the
+   memory for the stream is taken from the size bytes at mem provided by the
+   caller, instead of being allocated with zalloc.  deflateStateSize() returns
+   the number of bytes needed for the given windowBits and memLevel, or zero
+   if they are invalid.  mem must be aligned for any type, as for malloc().
+   Each buffer in the block is aligned to a 64-byte cache line.  This is for
+   applications that create many short-lived streams, and would rather not
+   call malloc() and free() several times for each.
+
+     deflateInitArena() sets zalloc, zfree, and opaque in strm.  The block must
+   not be used for anything else until deflateEnd() is called, after which it
+   can be used again for a new stream.  deflateCopy() returns Z_STREAM_ERROR
+   for a stream using an arena, since there is no room for a second stream
+   there -- a copy needs its own stream with a zalloc and zfree of its own.
+   deflateReset() and deflateParams() can be used as usual, except that the
+   Z_OPTIMAL strategy needs more memory than deflateStateSize() provides, so
+   deflateInitArena() and deflateParams() return Z_STREAM_ERROR for it on such
+   a stream.
+
+     deflateInitArena returns Z_OK if success, Z_MEM_ERROR if size is less than
+   deflateStateSize(windowBits, memLevel), Z_STREAM_ERROR for the Z_OPTIMAL
+   strategy, or as for deflateInit2().
+*/
+
 /*
 ZEXTERN int ZEXPORT inflateInit2 OF((z_streamp strm,
                                      int  windowBits));
@@ -960,6 +1040,32 @@ ZEXTERN long ZEXPORT inflateMark OF((z_streamp strm));
    source stream state was inconsistent.
 */
 
+ZEXTERN int ZEXPORT inflateContiguous OF((z_streamp strm, int contig));
+/*
+     If contig is true, inflateContiguous() tells inflate() that the output of
+   all of its calls goes to one contiguous buffer, each call starting where the
+   last one left off, and that the earlier output will stay in place until the
+   end of the stream.  inflate() then reads matches directly from the earlier
+   output instead of keeping a copy of the last 32K of it in a sliding window,
+   which saves both the copying and the memory for the window.  This is useful
+   when decompressing into one buffer in memory with the input arriving in
+   pieces.  If the application moves the buffer to enlarge it, then next_out
+   must be moved to the same offset in the new buffer.  inflateContiguous()
+   must be called before any output has been produced, that is after
+   inflateInit(), inflateInit2(), or inflateReset().  inflateReset(),
+   inflateReset2(), and inflateResetKeep() turn it off again, so it must be
+   called anew for each stream that is to be decompressed this way.
+
+     A dictionary can still be provided with inflateSetDictionary(), though
+   for raw inflate only before any output, since the dictionary precedes it.
+   inflateGetDictionary() returns the dictionary followed by the earlier
+   output.  A copy made with inflateCopy() shares the assumption, so it must
+   continue with output in the same place.
+
+     inflateContiguous returns Z_OK if success, or Z_STREAM_ERROR if the source
+   stream state was inconsistent or if output has already been produced.
+*/
+
 ZEXTERN int ZEXPORT inflateGetHeader OF((z_streamp strm,
                                          gz_headerp head));
 /*
@@ -1000,6 +1106,27 @@ ZEXTERN int ZEXPORT inflateGetHeader OF((z_streamp strm,
    stream state was inconsistent.
 */
 
+ZEXTERN uLong ZEXPORT inflateStateSize OF((int windowBits));
+/*
+ZEXTERN int ZEXPORT inflateInitArena OF((z_streamp strm, int windowBits,
+                                         voidpf mem, uLong size));
+
+     inflateInitArena() is the same as inflateInit2(), except that all of the
+   memory for the stream, including the sliding window allocated later by
+   inflate(), is taken from the size bytes at mem provided by the caller, as
+   described for deflateInitArena() above.  inflateStateSize() returns the
+   number of bytes needed for the given windowBits, or zero if it is invalid.
+   A windowBits of zero (or 32 or 16 + 0 for automatic header detection) is
+   sized for a window of 32K.  inflateReset2() with a larger window than the
+   arena was sized for, or after the window has been allocated with a
+   different size, will result in a Z_MEM_ERROR from inflate() when there is
+   no more room.  inflateCopy() returns Z_STREAM_ERROR for a stream using an
+   arena.
+
+     inflateInitArena returns Z_OK if success, Z_MEM_ERROR if size is less than
+   inflateStateSize(windowBits), or as for inflateInit2().
+*/
+
 /*
 ZEXTERN int ZEXPORT inflateBackInit OF((z_streamp strm, int windowBits,
                                         unsigned char FAR *window));
@@ -1229,8 +1356,9 @@ ZEXTERN gzFile ZEXPORT gzopen OF((const char *path, const char *mode));
      Opens a gzip (.gz) file for reading or writing.  The mode parameter is as
    in fopen ("rb" or "wb") but can also include a compression level ("wb9") or
    a strategy: 'f' for filtered data as in "wb6f", 'h' for Huffman-only
-   compression as in "wb1h", 'R' for run-length encoding as in "wb1R", or 'F'
-   for fixed code compression as in "wb9F".  (See the description of
+   compression as in "wb1h", 'R' for run-length encoding as in "wb1R", 'Q' for
+   the quick match search as in "wbQ", 'O' for optimal parsing as in "wb9O",
+   or 'F' for fixed code compression as in "wb9F".  (See the description of
    deflateInit2 for more information about the strategy parameter.)  'T' will
    request transparent writing or appending with no compression and not using
    the gzip format.
@@ -1241,6 +1369,8 @@ ZEXTERN gzFile ZEXPORT gzopen OF((const char *path, const char *mode));
    "x" when writing will create the file exclusively, which fails if the file
    already exists.  On systems that support it, the addition of "e" when
    reading or writing will set the flag to close the file on an execve() call.
+   If zlib was compiled with USE_MMAP, the addition of "m" when reading allows
+   the file to be mapped in memory (see gzread below).
 
      These functions, as well as gzip, will read and decode a sequence of gzip
    streams in a file.  The append function of gzopen() can be used to create
@@ -1334,6 +1464,15 @@ ZEXTERN int ZEXPORT gzread OF((gzFile file, voidp buf, unsigned len));
    stream.  Alternatively, gzerror can be used before gzclose to detect this
    case.
 
+     If zlib was compiled with USE_MMAP and the file was opened with "m" in the
+   mode, a regular input file larger than the input buffer is mapped in memory
+   when it is first read, and inflated directly from the mapping.  Data
+   appended to the file later is read as usual.  But if the file is truncated
+   while it is open for reading, reading the mapped part past the new end
+   raises SIGBUS instead of returning an error.  So "m" should not be used for
+   files that may be truncated while they are read, such as logs that are
+   rotated.  Without USE_MMAP, "m" is ignored.
+
      gzread returns the number of uncompressed bytes actually read, less than
    len for end of file, or -1 for error.
 */
@@ -1444,6 +1583,24 @@ ZEXTERN z_off_t ZEXPORT gzseek OF((gzFile file,
    would be before the current position.
 */
 
+ZEXTERN int ZEXPORT gzspan OF((gzFile file, unsigned long span));
+/*
+     Makes later seeks on a file opened for reading fast, by recording access
+   points while reading at deflate block boundaries about every span bytes of
+   uncompressed data, as in examples/zran.c.  A seek then resumes
+   decompression from the nearest access point at or before the target,
+   instead of from the start of the file or the current position.  Each access
+   point costs about 32K of memory, so span should not be too small -- a span
+   of a megabyte or more is reasonable.  A span of zero stops recording, but
+   keeps and continues to use the access points already recorded.  Access
+   points are only recorded if the file is seekable.
+
+     The check value of a gzip member entered at an access point cannot be
+   verified, so reading the rest of that member will not detect all errors.
+
+     gzspan returns 0 on success, or -1 if the file is not open for reading.
+*/
+
 ZEXTERN int ZEXPORT    gzrewind OF((gzFile file));
 /*
      Rewinds the given file. This function is supported only for reading.
@@ -1556,6 +1713,217 @@ ZEXTERN void ZEXPORT gzclearerr OF((gzFile file));
    file that is being written concurrently.
 */
 
+
+                        /* parallel gzip file writing */
+
+/*
+     These functions write a single gzip member using several threads to
+   compress.  The input is divided into blocks that are compressed
+   independently, each primed with the last 32K of the block before it so that
+   the compression ratio is close to that of gzwrite().  The output can be
+   read by gzread(), inflate(), or any gzip utility.  These functions require
+   POSIX threads.  Where threads are not available gzpdopen() returns NULL.
+*/
+
+typedef struct gzp_state FAR *gzpFile;      /* parallel gzip writer */
+
+ZEXTERN gzpFile ZEXPORT gzpdopen OF((int fd, int level, int threads));
+/*
+     Associate a parallel gzip writer with the file descriptor fd, which must
+   be open for writing.  level is the compression level, 0..9 or
+   Z_DEFAULT_COMPRESSION.  threads is the number of compression threads to
+   use, which is limited to 64.  The file descriptor is closed by gzpclose().
+
+     gzpdopen returns NULL if fd is -1, level is invalid, there is not enough
+   memory, or threads are not supported.
+*/
+
+ZEXTERN int ZEXPORT gzpbuffer OF((gzpFile file, unsigned size,
+                                  unsigned count));
+/*
+     Set the size of the blocks the input is divided into, and the maximum
+   number of blocks that may be in progress at once.  The default is 128K
+   blocks with twice as many blocks as threads.  The memory used is about
+   count * (2 * size + 32K) bytes.  Smaller blocks allow more parallelism on
+   small inputs at a small cost in compression.  gzpbuffer() must be called
+   before the first gzpwrite(), and returns 0 on success or -1 on failure.
+*/
+
+ZEXTERN int ZEXPORT gzpwrite OF((gzpFile file, voidpc buf, unsigned len));
+/*
+     Write len uncompressed bytes from buf.  Full blocks are handed to the
+   compression threads, and compressed blocks that are complete are written in
+   order.  gzpwrite() only waits when count blocks are already in progress.
+   Returns the number of bytes consumed, or 0 in case of error.
+*/
+
+ZEXTERN int ZEXPORT gzpclose OF((gzpFile file));
+/*
+     Compress any remaining input, write all compressed data and the gzip
+   trailer, stop the threads, close the file descriptor, and free the writer.
+   Returns Z_OK on success, Z_ERRNO on a file operation error, Z_MEM_ERROR if
+   out of memory, or Z_STREAM_ERROR if file is not valid.
+*/
+
+ZEXTERN int ZEXPORT gzpuncompress OF((int in, int out, int threads));
+/*
+     Decompress the gzip file read from the file descriptor in and write the
+   uncompressed data to the file descriptor out, using up to threads threads.
+   The compressed data is split where Z_FULL_FLUSH was used when compressing
+   (at least 256K of compressed data apart), and the pieces are decompressed
+   at the same time.  Any stream is decompressed correctly, but only streams
+   with full flush points, such as those written with gzflush(file,
+   Z_FULL_FLUSH) or deflate() with Z_FULL_FLUSH, are decompressed in parallel.
+   The output of gzpwrite() is not, since its blocks depend on one another.
+   The whole compressed file is read into memory.  Only the first gzip member
+   is decompressed.  Neither file descriptor is closed.
+
+     gzpuncompress returns Z_OK on success, Z_DATA_ERROR if the data is not
+   valid gzip data or the check value or length does not match, Z_BUF_ERROR
+   if the input ends early, Z_ERRNO on a read or write error, Z_MEM_ERROR if
+   out of memory, or Z_STREAM_ERROR if in or out is -1 or if zlib was built
+   without POSIX threads.
+*/
+
+
+                        /* random access index */
+
+/*
+     These functions build an index of a gzip or zlib file that allows reading
+   from any offset in the uncompressed data after decompressing no more than
+   about span bytes, instead of everything before it.  Each access point in
+   the index holds the preceding 32K of uncompressed data, kept compressed, so
+   the index takes about 10K per access point for typical data.  The index can
+   be saved to a separate file and loaded again later.  Only the first gzip or
+   zlib stream in the file is indexed.
+*/
+
+typedef struct gz_index_s FAR *gzIndex;     /* random access index */
+
+ZEXTERN int ZEXPORT gzindex_build OF((int fd, unsigned long span,
+                                      gzIndex *index));
+/*
+     Decompress the gzip or zlib stream read from fd, starting at its current
+   position, and build an index with access points about every span bytes of
+   uncompressed data.  If span is zero, 1 MB is used.  fd must later be
+   seekable to read using the index, and is not closed.  On success *index is
+   set to the new index, which must be freed with gzindex_free().
+
+     gzindex_build returns the number of access points (at least one) on
+   success, Z_DATA_ERROR if the stream is invalid or its check value does not
+   match, Z_BUF_ERROR if the input ends early, Z_ERRNO on a read error, or
+   Z_MEM_ERROR if out of memory.
+*/
+
+ZEXTERN int ZEXPORT gzindex_save OF((gzIndex index, int fd));
+/*
+     Write index to fd.  Returns Z_OK on success, Z_ERRNO on a write error, or
+   Z_MEM_ERROR if out of memory.  fd is not closed.
+*/
+
+ZEXTERN int ZEXPORT gzindex_load OF((int fd, gzIndex *index));
+/*
+     Read an index written by gzindex_save() from fd, and set *index to it.
+   Returns the number of access points on success, Z_DATA_ERROR if fd does
+   not contain a valid index, Z_ERRNO on a read error, or Z_MEM_ERROR if out
+   of memory.  fd is not closed.
+*/
+
+/*
+ZEXTERN int ZEXPORT gzindex_read OF((gzIndex index, int fd, z_off_t offset,
+                                     voidp buf, unsigned len));
+
+     Read up to len bytes of uncompressed data starting at offset into buf,
+   using index to find where to start decompressing the file fd.  A negative
+   offset counts back from the end of the uncompressed data, so -len reads the
+   last len bytes.  Returns the number of bytes read, which is less than len
+   only at the end of the data, or Z_DATA_ERROR if the file does not match the
+   index, Z_ERRNO on a read or seek error, or Z_MEM_ERROR if out of memory.
+   Only one thread may read from fd at a time, but an index may be shared.
+*/
+
+ZEXTERN void ZEXPORT gzindex_free OF((gzIndex index));
+/*
+     Free an index returned by gzindex_build() or gzindex_load().
+*/
+
+
+                        /* stream pools */
+
+/*
+     A stream pool keeps deflate and inflate streams that the application is
+   done with, reset so that they keep their memory, and hands them out again
+   when streams with the same parameters are requested.  This avoids the cost
+   of deflateInit2() and deflateEnd() for every short message.  A pool may be
+   used by several threads at once.  Each thread has its own idle streams, so
+   taking and returning streams does not wait on other threads.  These
+   functions require POSIX threads.  Where threads are not available
+   zpoolOpen() returns NULL.
+*/
+
+typedef struct z_pool_s FAR *z_poolp;       /* stream pool */
+
+ZEXTERN z_poolp ZEXPORT zpoolOpen OF((unsigned max));
+/*
+     Make a new stream pool.  Each thread keeps at most max idle streams, the
+   least recently used being freed when there are more.  If max is zero, 16 is
+   used.  zpoolOpen returns NULL if there is not enough memory or threads are
+   not supported.
+*/
+
+ZEXTERN z_streamp ZEXPORT zpoolDeflate OF((z_poolp pool, int level,
+                                           int windowBits, int memLevel,
+                                           int strategy));
+ZEXTERN z_streamp ZEXPORT zpoolInflate OF((z_poolp pool, int windowBits));
+/*
+     Return a deflate stream initialized as by deflateInit2() with the given
+   parameters and the Z_DEFLATED method, or an inflate stream initialized as
+   by inflateInit2() with windowBits.  An idle stream in this thread with
+   exactly the same parameters is used if there is one, which counts as a hit.
+   Otherwise a new stream is made, which counts as a miss.  The application
+   sets next_in, avail_in, next_out, and avail_out as usual, and must not
+   change zalloc, zfree, or opaque.  The stream must be returned with
+   zpoolRelease() and not with deflateEnd() or inflateEnd().
+
+     zpoolDeflate and zpoolInflate return Z_NULL if there is not enough
+   memory, a parameter is invalid, or pool is NULL.
+*/
+
+ZEXTERN int ZEXPORT zpoolRelease OF((z_poolp pool, z_streamp strm));
+/*
+     Return a stream from zpoolDeflate() or zpoolInflate() to pool, whether or
+   not it finished.  The stream is reset with deflateReset() or inflateReset()
+   and kept with this thread's idle streams, and may be given out again by a
+   later request from this thread.  A level, strategy, or windowBits changed
+   with deflateParams() or inflateReset2() is set back to the one the stream
+   was made with, and a gzip header from deflateSetHeader() is dropped.  The
+   resets also undo deflateTune(), deflatePrime(), inflateContiguous(),
+   inflateGetHeader(), and any dictionary, so that the next user gets the
+   stream as it was made.  The application must not use strm after this call.
+   A stream may be released by a different thread than the one that got it.
+
+     zpoolRelease returns Z_OK if success, or Z_STREAM_ERROR if pool or strm is
+   NULL or the stream state was inconsistent, or Z_MEM_ERROR if out of memory.
+   In the error cases the stream is freed.
+*/
+
+ZEXTERN int ZEXPORT zpoolStats OF((z_poolp pool, unsigned long *hits,
+                                   unsigned long *misses));
+/*
+     Set *hits to the number of requests served by an idle stream, and *misses
+   to the number that made a new stream, over all threads since the pool was
+   made.  Either pointer may be NULL.  Counts from threads that are using the
+   pool at the same time may lag slightly.  zpoolStats returns Z_OK, or
+   Z_STREAM_ERROR if pool is NULL.
+*/
+
+ZEXTERN int ZEXPORT zpoolClose OF((z_poolp pool));
+/*
+     Free all idle streams and the pool.  Streams not yet released are not
+   freed, and must not be released afterwards.  No other thread may be using
+   the pool.  Returns Z_OK, or Z_STREAM_ERROR if pool is NULL.
+*/
+
 #endif /* !Z_SOLO */
 
                         /* checksum functions */
@@ -1644,6 +2012,16 @@ ZEXTERN int ZEXPORT inflateBackInit_ OF((z_streamp strm, int windowBits,
                                          unsigned char FAR *window,
                                          const char *version,
                                          int stream_size));
+ZEXTERN int ZEXPORT deflateInitArena_ OF((z_streamp strm, int level,
+                                          int method, int windowBits,
+                                          int memLevel, int strategy,
+                                          voidpf mem, uLong size,
+                                          const char *version,
+                                          int stream_size));
+ZEXTERN int ZEXPORT inflateInitArena_ OF((z_streamp strm, int windowBits,
+                                          voidpf mem, uLong size,
+                                          const char *version,
+                                          int stream_size));
 #define deflateInit(strm, level) \
         deflateInit_((strm), (level), ZLIB_VERSION, (int)sizeof(z_stream))
 #define inflateInit(strm) \
@@ -1657,6 +2035,14 @@ ZEXTERN int ZEXPORT inflateBackInit_ OF((z_streamp strm, int windowBits,
 #define inflateBackInit(strm, windowBits, window) \
         inflateBackInit_((strm), (windowBits), (window), \
                       ZLIB_VERSION, (int)sizeof(z_stream))
+#define deflateInitArena(strm, level, method, windowBits, memLevel, strategy, \
+                         mem, size) \
+        deflateInitArena_((strm),(level),(method),(windowBits),(memLevel),\
+                          (strategy),(mem),(size),ZLIB_VERSION,\
+                          (int)sizeof(z_stream))
+#define inflateInitArena(strm, windowBits, mem, size) \
+        inflateInitArena_((strm), (windowBits), (mem), (size), ZLIB_VERSION, \
+                          (int)sizeof(z_stream))
 
 #ifndef Z_SOLO
 
@@ -1695,6 +2081,8 @@ ZEXTERN int ZEXPORT gzgetc_ OF((gzFile file));  /* backward compatibility */
    ZEXTERN z_off64_t ZEXPORT gzoffset64 OF((gzFile));
    ZEXTERN uLong ZEXPORT adler32_combine64 OF((uLong, uLong, z_off64_t));
    ZEXTERN uLong ZEXPORT crc32_combine64 OF((uLong, uLong, z_off64_t));
+   ZEXTERN int ZEXPORT gzindex_read64 OF((gzIndex, int, z_off64_t,
+                                          voidp, unsigned));
 #endif
 
 #if !defined(ZLIB_INTERNAL) && defined(Z_WANT64)
@@ -1705,6 +2093,7 @@ ZEXTERN int ZEXPORT gzgetc_ OF((gzFile file));  /* backward compatibility */
 #    define z_gzoffset z_gzoffset64
 #    define z_adler32_combine z_adler32_combine64
 #    define z_crc32_combine z_crc32_combine64
+#    define z_gzindex_read z_gzindex_read64
 #  else
 #    define gzopen gzopen64
 #    define gzseek gzseek64
@@ -1712,6 +2101,7 @@ ZEXTERN int ZEXPORT gzgetc_ OF((gzFile file));  /* backward compatibility */
 #    define gzoffset gzoffset64
 #    define adler32_combine adler32_combine64
 #    define crc32_combine crc32_combine64
+#    define gzindex_read gzindex_read64
 #  endif
 #  ifndef Z_LARGE64
      ZEXTERN gzFile ZEXPORT gzopen64 OF((const char *, const char *));
@@ -1720,6 +2110,8 @@ ZEXTERN int ZEXPORT gzgetc_ OF((gzFile file));  /* backward compatibility */
      ZEXTERN z_off_t ZEXPORT gzoffset64 OF((gzFile));
      ZEXTERN uLong ZEXPORT adler32_combine64 OF((uLong, uLong, z_off_t));
      ZEXTERN uLong ZEXPORT crc32_combine64 OF((uLong, uLong, z_off_t));
+     ZEXTERN int ZEXPORT gzindex_read64 OF((gzIndex, int, z_off_t,
+                                            voidp, unsigned));
 #  endif
 #else
    ZEXTERN gzFile ZEXPORT gzopen OF((const char *, const char *));
@@ -1728,6 +2120,8 @@ ZEXTERN int ZEXPORT gzgetc_ OF((gzFile file));  /* backward compatibility */
    ZEXTERN z_off_t ZEXPORT gzoffset OF((gzFile));
    ZEXTERN uLong ZEXPORT adler32_combine OF((uLong, uLong, z_off_t));
    ZEXTERN uLong ZEXPORT crc32_combine OF((uLong, uLong, z_off_t));
+   ZEXTERN int ZEXPORT gzindex_read OF((gzIndex, int, z_off_t,
+                                        voidp, unsigned));
 #endif
 
 #else /* Z_SOLO */
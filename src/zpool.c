@@ -0,0 +1,430 @@
+/* zpool.c -- pools of reusable deflate and inflate streams
+ * Copyright (C) 1995-2013 Jean-loup Gailly and Mark Adler
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+   deflateInit2() allocates about 256K for the default parameters and
+   deflateEnd() frees it, which dominates the cost of compressing a short
+   message.  A pool keeps finished streams instead, reset with deflateReset()
+   or inflateReset() so that their memory is kept, and hands them out again
+   for the same parameters.
+
+   Each thread has its own list of idle streams, found with a pthread key, so
+   taking and returning a stream needs no shared lock.  The lists are kept in
+   most recently used order, and when a list grows past the limit the least
+   recently used stream is freed.  The pool lock is only taken when a thread
+   first uses the pool, when it exits, and for the statistics.  Each thread's
+   hit and miss counts have a lock of their own, which only the statistics
+   contend for.  A stream may be returned by a different thread than the one
+   that took it, in which case it joins the returning thread's list.
+ */
+
+#include "zutil.h"
+
+#ifndef NO_ZPOOL
+#  if defined(NO_PTHREADS) || (defined(_WIN32) && !defined(__CYGWIN__))
+#    define NO_ZPOOL
+#  endif
+#endif
+
+#ifndef NO_ZPOOL
+
+#include <pthread.h>
+
+#define ZPOOL_IDLE 16       /* default limit on idle streams per thread */
+
+/* a pooled stream and the parameters it was made with */
+typedef struct zpool_item_s {
+    z_stream strm;          /* the stream handed out -- must be first */
+    struct zpool_item_s *next;  /* next idle stream in this thread */
+    int inf;                /* true for an inflate stream */
+    int level;              /* deflateInit2() parameters, or */
+    int windowBits;         /*  inflateInit2() windowBits with */
+    int memLevel;           /*  the others zero */
+    int strategy;
+} zpool_item;
+
+/* one thread's idle streams */
+typedef struct zpool_cache_s {
+    struct zpool_cache_s *next; /* next thread using the pool */
+    struct z_pool_s *pool;  /* pool this belongs to */
+    zpool_item *idle;       /* idle streams, most recently used first */
+    unsigned count;         /* number of idle streams */
+    pthread_mutex_t lock;   /* protects hits and misses */
+    unsigned long hits;     /* requests served from idle */
+    unsigned long misses;   /* requests that made a new stream */
+} zpool_cache;
+
+/* stream pool */
+struct z_pool_s {
+    unsigned max;           /* limit on idle streams per thread */
+    pthread_key_t key;      /* this thread's zpool_cache */
+    pthread_mutex_t lock;   /* protects everything below */
+    zpool_cache *caches;    /* list of all threads' caches */
+    unsigned long hits;     /* hits from threads that have exited */
+    unsigned long misses;   /* misses from threads that have exited */
+};
+
+/* Local functions */
+local void zpool_end OF((zpool_item *));
+local void zpool_drop OF((zpool_cache *));
+local void zpool_exit OF((void *));
+local zpool_cache *zpool_cache_get OF((z_poolp));
+local zpool_item *zpool_take OF((z_poolp, int, int, int, int, int));
+
+/* End and free a pooled stream. */
+local void zpool_end(item)
+    zpool_item *item;
+{
+    if (item->inf)
+        (void)inflateEnd(&item->strm);
+    else
+        (void)deflateEnd(&item->strm);
+    free(item);
+}
+
+/* Free all of the idle streams in cache and the cache itself. */
+local void zpool_drop(cache)
+    zpool_cache *cache;
+{
+    zpool_item *item;
+
+    while ((item = cache->idle) != NULL) {
+        cache->idle = item->next;
+        zpool_end(item);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/* Called when a thread that used the pool exits: keep its counts and free
+   its idle streams. */
+local void zpool_exit(arg)
+    void *arg;
+{
+    zpool_cache *cache = arg, **prev;
+    z_poolp pool = cache->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    prev = &pool->caches;
+    while (*prev != cache)
+        prev = &(*prev)->next;
+    *prev = cache->next;
+    pool->hits += cache->hits;
+    pool->misses += cache->misses;
+    pthread_mutex_unlock(&pool->lock);
+    zpool_drop(cache);
+}
+
+/* Return this thread's cache for pool, making it if needed.  Return NULL if
+   out of memory. */
+local zpool_cache *zpool_cache_get(pool)
+    z_poolp pool;
+{
+    zpool_cache *cache;
+
+    cache = pthread_getspecific(pool->key);
+    if (cache != NULL)
+        return cache;
+    cache = malloc(sizeof(zpool_cache));
+    if (cache == NULL)
+        return NULL;
+    cache->pool = pool;
+    cache->idle = NULL;
+    cache->count = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    if (pthread_mutex_init(&cache->lock, NULL)) {
+        free(cache);
+        return NULL;
+    }
+    if (pthread_setspecific(pool->key, cache)) {
+        pthread_mutex_destroy(&cache->lock);
+        free(cache);
+        return NULL;
+    }
+    pthread_mutex_lock(&pool->lock);
+    cache->next = pool->caches;
+    pool->caches = cache;
+    pthread_mutex_unlock(&pool->lock);
+    return cache;
+}
+
+/* Take an idle stream with the given parameters from this thread's cache, or
+   make a new one.  Return NULL if out of memory or the parameters are
+   invalid. */
+local zpool_item *zpool_take(pool, inf, level, windowBits, memLevel,
+                             strategy)
+    z_poolp pool;
+    int inf;
+    int level;
+    int windowBits;
+    int memLevel;
+    int strategy;
+{
+    int ret;
+    zpool_cache *cache;
+    zpool_item *item, **prev;
+
+    if (pool == NULL)
+        return NULL;
+    cache = zpool_cache_get(pool);
+    if (cache == NULL)
+        return NULL;
+
+    /* look for a match, most recently used first */
+    prev = &cache->idle;
+    while ((item = *prev) != NULL) {
+        if (item->inf == inf && item->level == level &&
+            item->windowBits == windowBits && item->memLevel == memLevel &&
+            item->strategy == strategy) {
+            *prev = item->next;
+            cache->count--;
+            pthread_mutex_lock(&cache->lock);
+            cache->hits++;
+            pthread_mutex_unlock(&cache->lock);
+            return item;
+        }
+        prev = &item->next;
+    }
+
+    /* none idle -- make a new one */
+    pthread_mutex_lock(&cache->lock);
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+    item = malloc(sizeof(zpool_item));
+    if (item == NULL)
+        return NULL;
+    item->inf = inf;
+    item->level = level;
+    item->windowBits = windowBits;
+    item->memLevel = memLevel;
+    item->strategy = strategy;
+    item->strm.zalloc = Z_NULL;
+    item->strm.zfree = Z_NULL;
+    item->strm.opaque = Z_NULL;
+    item->strm.next_in = Z_NULL;
+    item->strm.avail_in = 0;
+    if (inf)
+        ret = inflateInit2(&item->strm, windowBits);
+    else
+        ret = deflateInit2(&item->strm, level, Z_DEFLATED, windowBits,
+                           memLevel, strategy);
+    if (ret != Z_OK) {
+        free(item);
+        return NULL;
+    }
+    return item;
+}
+
+/* -- see zlib.h -- */
+z_poolp ZEXPORT zpoolOpen(max)
+    unsigned max;
+{
+    z_poolp pool;
+
+    pool = malloc(sizeof(struct z_pool_s));
+    if (pool == NULL)
+        return NULL;
+    pool->max = max ? max : ZPOOL_IDLE;
+    pool->caches = NULL;
+    pool->hits = 0;
+    pool->misses = 0;
+    if (pthread_key_create(&pool->key, zpool_exit)) {
+        free(pool);
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->lock, NULL)) {
+        pthread_key_delete(pool->key);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/* -- see zlib.h -- */
+z_streamp ZEXPORT zpoolDeflate(pool, level, windowBits, memLevel, strategy)
+    z_poolp pool;
+    int level;
+    int windowBits;
+    int memLevel;
+    int strategy;
+{
+    zpool_item *item;
+
+    item = zpool_take(pool, 0, level, windowBits, memLevel, strategy);
+    return item == NULL ? Z_NULL : &item->strm;
+}
+
+/* -- see zlib.h -- */
+z_streamp ZEXPORT zpoolInflate(pool, windowBits)
+    z_poolp pool;
+    int windowBits;
+{
+    zpool_item *item;
+
+    item = zpool_take(pool, 1, 0, windowBits, 0, 0);
+    return item == NULL ? Z_NULL : &item->strm;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT zpoolRelease(pool, strm)
+    z_poolp pool;
+    z_streamp strm;
+{
+    int ret;
+    zpool_cache *cache;
+    zpool_item *item, *last;
+
+    if (pool == NULL || strm == Z_NULL)
+        return Z_STREAM_ERROR;
+    item = (zpool_item *)strm;
+
+    /* reset the stream, keeping its memory, or free it if that fails or this
+       thread has no cache -- deflateReset() keeps the level and strategy from
+       deflateParams() and the header from deflateSetHeader(), so put those
+       back as they were made, since the header may no longer exist; the
+       resets undo the rest: deflateTune(), deflatePrime(), and dictionaries,
+       and inflateContiguous(), inflateGetHeader(), and inflateUndermine() */
+    if (item->inf)
+        ret = inflateReset2(strm, item->windowBits);
+    else {
+        ret = deflateReset(strm);
+        if (ret == Z_OK)
+            ret = deflateParams(strm, item->level,
+                                item->strategy &
+                                ~(Z_HASH_CRC | Z_MATCH_TREE));
+        if (ret == Z_OK && item->windowBits > 15)
+            ret = deflateSetHeader(strm, Z_NULL);
+    }
+    cache = ret == Z_OK ? zpool_cache_get(pool) : NULL;
+    if (cache == NULL) {
+        zpool_end(item);
+        return ret == Z_OK ? Z_MEM_ERROR : ret;
+    }
+
+    /* put it at the front, dropping the least recently used if full */
+    item->next = cache->idle;
+    cache->idle = item;
+    if (cache->count < pool->max) {
+        cache->count++;
+        return Z_OK;
+    }
+    last = item;
+    while (last->next->next != NULL)
+        last = last->next;
+    zpool_end(last->next);
+    last->next = NULL;
+    return Z_OK;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT zpoolStats(pool, hits, misses)
+    z_poolp pool;
+    unsigned long *hits;
+    unsigned long *misses;
+{
+    unsigned long h, m;
+    zpool_cache *cache;
+
+    if (pool == NULL)
+        return Z_STREAM_ERROR;
+    pthread_mutex_lock(&pool->lock);
+    h = pool->hits;
+    m = pool->misses;
+    for (cache = pool->caches; cache != NULL; cache = cache->next) {
+        pthread_mutex_lock(&cache->lock);
+        h += cache->hits;
+        m += cache->misses;
+        pthread_mutex_unlock(&cache->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (hits != NULL)
+        *hits = h;
+    if (misses != NULL)
+        *misses = m;
+    return Z_OK;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT zpoolClose(pool)
+    z_poolp pool;
+{
+    zpool_cache *cache;
+
+    if (pool == NULL)
+        return Z_STREAM_ERROR;
+    pthread_key_delete(pool->key);
+    while ((cache = pool->caches) != NULL) {
+        pool->caches = cache->next;
+        zpool_drop(cache);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    return Z_OK;
+}
+
+#else /* NO_ZPOOL */
+
+/* no threads available -- zpoolOpen() always fails */
+
+z_poolp ZEXPORT zpoolOpen(max)
+    unsigned max;
+{
+    (void)max;
+    return NULL;
+}
+
+z_streamp ZEXPORT zpoolDeflate(pool, level, windowBits, memLevel, strategy)
+    z_poolp pool;
+    int level;
+    int windowBits;
+    int memLevel;
+    int strategy;
+{
+    (void)pool;
+    (void)level;
+    (void)windowBits;
+    (void)memLevel;
+    (void)strategy;
+    return Z_NULL;
+}
+
+z_streamp ZEXPORT zpoolInflate(pool, windowBits)
+    z_poolp pool;
+    int windowBits;
+{
+    (void)pool;
+    (void)windowBits;
+    return Z_NULL;
+}
+
+int ZEXPORT zpoolRelease(pool, strm)
+    z_poolp pool;
+    z_streamp strm;
+{
+    (void)pool;
+    (void)strm;
+    return Z_STREAM_ERROR;
+}
+
+int ZEXPORT zpoolStats(pool, hits, misses)
+    z_poolp pool;
+    unsigned long *hits;
+    unsigned long *misses;
+{
+    (void)pool;
+    (void)hits;
+    (void)misses;
+    return Z_STREAM_ERROR;
+}
+
+int ZEXPORT zpoolClose(pool)
+    z_poolp pool;
+{
+    (void)pool;
+    return Z_STREAM_ERROR;
+}
+
+#endif /* NO_ZPOOL */
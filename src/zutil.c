@@ -322,3 +322,47 @@ void ZLIB_INTERNAL zcfree (opaque, ptr)
 #endif /* MY_ZCALLOC */
 
 #endif /* !Z_SOLO */
+
+/* Set up an arena in the size bytes at mem, and return it for use as the
+   opaque pointer for zaralloc() and zarfree(). */
+voidpf ZLIB_INTERNAL zarena(mem, size)
+    voidpf mem;
+    ulg size;
+{
+    z_arena FAR *arena = (z_arena FAR *)mem;
+    uchf *next = (uchf *)mem + sizeof(z_arena);
+    ulg used;
+
+    next += (unsigned)(-(ptrdiff_t)next & (Z_ARENA_ALIGN - 1));
+    used = (ulg)(next - (uchf *)mem);
+    arena->next = next;
+    arena->left = size > used ? size - used : 0;
+    return (voidpf)arena;
+}
+
+voidpf ZLIB_INTERNAL zaralloc(opaque, items, size)
+    voidpf opaque;
+    unsigned items;
+    unsigned size;
+{
+    z_arena FAR *arena = (z_arena FAR *)opaque;
+    ulg need = Z_ARENA_SIZE((ulg)items * size);
+    uchf *ptr = arena->next;
+
+    if (need > arena->left)
+        return Z_NULL;
+    arena->next += need;
+    arena->left -= need;
+    return (voidpf)ptr;
+}
+
+/* Memory is not given back to the arena, since all of the allocations for a
+   stream are released together by deflateEnd() or inflateEnd(), after which
+   the caller can reuse or free the whole block. */
+void ZLIB_INTERNAL zarfree(opaque, ptr)
+    voidpf opaque;
+    voidpf ptr;
+{
+    (void)opaque;
+    (void)ptr;
+}
@@ -235,12 +235,40 @@ extern z_const char * const z_errmsg[10]; /* indexed by 2-zlib_error */
 #  define Tracecv(c,x)
 #endif
 
+/* an eight-byte unsigned type, if available, for the braided crc32() */
+#if !defined(Z_U8) && !defined(Z_SOLO) && defined(STDC)
+#  include <limits.h>
+#  if (ULONG_MAX == 0xffffffffffffffff)
+#    define Z_U8 unsigned long
+#  elif defined(ULLONG_MAX) && (ULLONG_MAX == 0xffffffffffffffff)
+#    define Z_U8 unsigned long long
+#  elif (UINT_MAX == 0xffffffffffffffff)
+#    define Z_U8 unsigned
+#  endif
+#endif
+
 #ifndef Z_SOLO
    voidpf ZLIB_INTERNAL zcalloc OF((voidpf opaque, unsigned items,
                                     unsigned size));
    void ZLIB_INTERNAL zcfree  OF((voidpf opaque, voidpf ptr));
 #endif
 
+/* arena allocation for deflateInitArena() and inflateInitArena() -- the
+   arena header is at the start of the caller's memory, and allocations are
+   taken in order from the rest, each aligned to Z_ARENA_ALIGN bytes */
+typedef struct {
+    uchf *next;                 /* next free byte, aligned */
+    ulg left;                   /* number of free bytes at next */
+} z_arena;
+#define Z_ARENA_ALIGN 64        /* cache line size */
+#define Z_ARENA_SIZE(n) \
+           (((ulg)(n) + (Z_ARENA_ALIGN - 1)) & ~(ulg)(Z_ARENA_ALIGN - 1))
+#define Z_ARENA_HEAD ((ulg)sizeof(z_arena) + (Z_ARENA_ALIGN - 1))
+voidpf ZLIB_INTERNAL zarena OF((voidpf mem, ulg size));
+voidpf ZLIB_INTERNAL zaralloc OF((voidpf opaque, unsigned items,
+                                  unsigned size));
+void ZLIB_INTERNAL zarfree OF((voidpf opaque, voidpf ptr));
+
 #define ZALLOC(strm, items, size) \
            (*((strm)->zalloc))((strm)->opaque, (items), (size))
 #define ZFREE(strm, addr)  (*((strm)->zfree))((strm)->opaque, (voidpf)(addr))